@@ -0,0 +1,25 @@
+#ifndef LILAC_CAMERA_H
+#define LILAC_CAMERA_H
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+namespace Lilac
+{
+// Orthographic camera, uploaded to the shaders through SceneUniforms
+struct Camera
+{
+	glm::vec3 forward{ -0.57735027f, -0.57735027f, -0.57735027f };
+	glm::vec3 up{ 0.0f, 1.0f, 0.0f };
+	glm::vec3 origin{ 16.0f, 16.0f, 16.0f };
+	float halfSize = 6.0f; // Half the height of the view, in world units
+
+	// Inverse of pixel_coords_to_camera_coords, the distance along forward is dropped
+	[[nodiscard]] glm::vec2 worldToPixelCoords(glm::vec3 position, glm::vec2 imageSize) const;
+
+	// Moves the origin across the view plane, in world units along the image right and up
+	void pan(glm::vec2 offset);
+};
+}
+
+#endif // LILAC_CAMERA_H
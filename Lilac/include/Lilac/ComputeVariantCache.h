@@ -0,0 +1,60 @@
+#ifndef LILAC_COMPUTE_VARIANT_CACHE_H
+#define LILAC_COMPUTE_VARIANT_CACHE_H
+
+#include <Lilac/Shader.h>
+#include <Lilac/Program.h>
+#include <Lilac/ShaderCompileQueue.h>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace Lilac
+{
+// One compute shader source built into several programs, each specialized by its own set of macros
+// Features are macro overrides on top of the base macros, #if on them compiles the other branches out
+// Every feature set is compiled once through the queue and kept for the lifetime of the cache
+class ComputeVariantCache
+{
+public:
+	using Features = std::map<std::string, std::string>;
+
+	ComputeVariantCache(std::string source, std::map<std::string, std::string> baseMacros, ShaderCompileQueue& queue);
+
+	// Submits the variant to the queue unless it is already cached, so it is ready by the time it is needed
+	void prepare(const Features& features);
+
+	// nullptr until the queue has finished building the variant, or if it failed, submits it on first use
+	[[nodiscard]] ComputeProgram* tryGet(const Features& features);
+
+	// Waits for the variant, nullptr if it failed
+	[[nodiscard]] ComputeProgram* get(const Features& features);
+
+	[[nodiscard]] bool isFailed(const Features& features) const;
+	[[nodiscard]] size_t getVariantCount() const;
+
+	// The base macros with the features applied, what the variant's shader is preprocessed with
+	[[nodiscard]] std::map<std::string, std::string> getMacros(const Features& features) const;
+
+private:
+	struct Variant
+	{
+		// Heap allocated, the queue and callers hold on to the program, and the program to the shader
+		std::unique_ptr<ComputeShader> shader;
+		std::unique_ptr<ComputeProgram> program;
+	};
+
+	Variant& getVariant(const Features& features);
+
+	static std::string formatFeatures(const Features& features);
+
+	std::string m_source;
+	std::map<std::string, std::string> m_baseMacros;
+	ShaderCompileQueue& m_queue;
+
+	std::map<Features, Variant> m_variants;
+};
+}
+
+#endif // LILAC_COMPUTE_VARIANT_CACHE_H
@@ -0,0 +1,69 @@
+#ifndef LILAC_FRAME_CAPTURE_H
+#define LILAC_FRAME_CAPTURE_H
+
+#include <Lilac/OpenGL.h>
+
+#include <glm/vec2.hpp>
+
+#include <array>
+#include <cstddef>
+#include <filesystem>
+
+namespace Lilac
+{
+// Asynchronous texture readback into image files, so capturing frames doesn't stall the pipeline
+// Each capture is copied into a pixel buffer object with a fence behind it, then mapped and written out a few frames later
+class FrameCapture
+{
+public:
+	enum class Format
+	{
+		Ppm, // 8 bits per channel, rgba8 textures, or anything clamped to [0, 1]
+		Pfm // 32 bit float per channel, keeps the range of rgba16f and rgba32f textures
+	};
+
+	FrameCapture();
+	~FrameCapture();
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// Queues a copy of the bottom left `size` pixels of the texture, false if every slot is still in flight
+	bool capture(GLuint texture, glm::ivec2 size, Format format, std::filesystem::path path);
+
+	// Writes every capture the GPU has finished copying, without waiting on the rest
+	void poll();
+
+	// Waits for every capture in flight and writes it
+	void finish();
+
+	[[nodiscard]] size_t getPendingCount() const;
+
+	// Captures that were dropped or couldn't be written out, since construction
+	[[nodiscard]] size_t getFailedCount() const;
+
+private:
+	struct Slot
+	{
+		GLuint buffer = 0;
+		size_t capacity = 0;
+		GLsync fence = nullptr;
+		glm::ivec2 size{ 0, 0 };
+		Format format = Format::Ppm;
+		std::filesystem::path path;
+	};
+
+	// False if the copy hasn't finished and isBlocking is false
+	bool writeOldest(bool isBlocking);
+
+	static constexpr size_t s_slotCount = 3;
+
+	std::array<Slot, s_slotCount> m_slots;
+	size_t m_oldest;
+	size_t m_pendingCount;
+	size_t m_failedCount;
+	GLuint m_framebuffer; // Read framebuffer the captured texture is attached to
+};
+}
+
+#endif // LILAC_FRAME_CAPTURE_H
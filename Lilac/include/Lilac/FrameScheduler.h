@@ -0,0 +1,60 @@
+#ifndef LILAC_FRAME_SCHEDULER_H
+#define LILAC_FRAME_SCHEDULER_H
+
+#include <SFML3D/System.hpp>
+
+#include <cstdint>
+
+namespace Lilac
+{
+// Decides when the raytracer has to run, so an unchanged scene costs nothing but waiting on events.
+// A frame is dispatched when the scene or camera revision moves, and again for every progressive frame
+// until maxAccumulatedFrames, after that the cached image is only presented again when asked to.
+class FrameScheduler
+{
+public:
+	FrameScheduler(sf3d::Time targetFrameTime, unsigned int maxAccumulatedFrames);
+
+	// Restarts accumulation if either revision moved since the last call
+	void update(uint64_t sceneRevision, uint64_t cameraRevision);
+
+	// Starts accumulating from scratch for anything else that invalidates the image, e.g. a new render resolution
+	void restart();
+
+	[[nodiscard]] bool shouldDispatch() const;
+
+	// Every pixel holds maxAccumulatedFrames frames, this stays true until the next restart
+	[[nodiscard]] bool isConverged() const;
+	[[nodiscard]] bool shouldPresent() const;
+
+	// Nothing to dispatch or present, the caller can block on events
+	[[nodiscard]] bool isIdle() const;
+
+	// Frames already held by the accumulation image, 0 means the next dispatch starts over
+	[[nodiscard]] unsigned int getAccumulatedFrames() const;
+
+	void onDispatched();
+	void onPresented();
+
+	// Present the cached image again, e.g. after a resize or the window being exposed
+	void requestPresent();
+
+	// Sleeps out the rest of the target frame time, doesn't sleep when idle since waiting on events already blocks
+	void paceFrame();
+
+private:
+	sf3d::Time m_targetFrameTime;
+	sf3d::Clock m_frameClock;
+
+	unsigned int m_maxAccumulatedFrames;
+	unsigned int m_accumulatedFrames;
+
+	uint64_t m_sceneRevision;
+	uint64_t m_cameraRevision;
+	bool m_hasRevisions;
+
+	bool m_isPresentRequested;
+};
+}
+
+#endif // LILAC_FRAME_SCHEDULER_H
@@ -0,0 +1,81 @@
+#ifndef LILAC_GPU_PROFILER_H
+#define LILAC_GPU_PROFILER_H
+
+#include <Lilac/OpenGL.h>
+#include <Lilac/GpuTimer.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Lilac
+{
+// GPU time of named passes, from GL_TIMESTAMP queries around each pass
+// One GpuTimer per pass, so passes can nest and results are only read once the GPU is done with them
+class GpuProfiler
+{
+public:
+	struct Stats
+	{
+		float minMilliseconds = 0.0f;
+		float averageMilliseconds = 0.0f;
+		float p99Milliseconds = 0.0f;
+		size_t sampleCount = 0; // Over the last s_windowSize samples at most
+	};
+
+	// Times everything submitted during its lifetime
+	class Scope
+	{
+	public:
+		Scope(GpuProfiler& profiler, const std::string& pass);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		GpuProfiler& m_profiler;
+		std::string m_pass;
+	};
+
+	GpuProfiler() = default;
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	// A pass can't nest inside itself, skipped if every query of the pass is still in flight
+	void begin(const std::string& pass);
+	void end(const std::string& pass);
+
+	// Reads every finished measurement without waiting, call once per frame
+	void collect();
+
+	// Measurements of the pass read by the last collect, oldest first
+	[[nodiscard]] const std::vector<float>& getCollected(const std::string& pass) const;
+
+	[[nodiscard]] Stats getStats(const std::string& pass) const;
+
+	// One line per pass, in name order
+	void print(std::ostream& stream) const;
+	bool writeFile(const std::filesystem::path& path) const;
+
+private:
+	static constexpr size_t s_windowSize = 256;
+
+	struct Pass
+	{
+		GpuTimer timer;
+		std::vector<float> collected;
+
+		std::vector<float> samples; // Ring of the last s_windowSize measurements
+		size_t nextSample = 0;
+	};
+
+	std::map<std::string, Pass> m_passes;
+};
+}
+
+#endif // LILAC_GPU_PROFILER_H
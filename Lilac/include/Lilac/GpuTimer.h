@@ -0,0 +1,40 @@
+#ifndef LILAC_GPU_TIMER_H
+#define LILAC_GPU_TIMER_H
+
+#include <Lilac/OpenGL.h>
+
+#include <array>
+#include <cstddef>
+
+namespace Lilac
+{
+// Pairs of GL_TIMESTAMP queries in a ring, results are read a few frames later so the CPU never waits on the GPU
+// Timestamps rather than GL_TIME_ELAPSED, which llvmpipe answers with next to nothing and which can't nest
+// One timed section, GpuProfiler keeps one per named pass
+class GpuTimer
+{
+public:
+	GpuTimer();
+	~GpuTimer();
+
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+	// Everything submitted in between is timed, skipped while already timing or if every query is still in flight
+	void begin();
+	void end();
+
+	// Oldest finished measurement, false if none is ready yet
+	bool tryGetElapsed(float& milliseconds);
+
+private:
+	static constexpr size_t s_queryPairCount = 8;
+
+	std::array<GLuint, 2 * s_queryPairCount> m_queries; // Begin and end timestamp of each pair
+	size_t m_oldest;
+	size_t m_pendingCount;
+	bool m_isTiming;
+};
+}
+
+#endif // LILAC_GPU_TIMER_H
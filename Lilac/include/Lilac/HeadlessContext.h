@@ -0,0 +1,33 @@
+#ifndef LILAC_HEADLESS_CONTEXT_H
+#define LILAC_HEADLESS_CONTEXT_H
+
+namespace Lilac
+{
+// Offscreen OpenGL 4.3 core context through EGL, for rendering without a window or a display server
+// Surfaceless where the driver allows it, Mesa does with llvmpipe too, otherwise on a 1x1 pbuffer that is never drawn to
+// There is no default framebuffer to present, everything is rendered into textures
+class HeadlessContext
+{
+public:
+	// Current on the constructing thread once valid
+	HeadlessContext();
+	~HeadlessContext();
+
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	// False if no display, config or context could be created, the reason is logged
+	[[nodiscard]] bool isValid() const;
+
+private:
+	bool create();
+
+	// EGLDisplay, EGLSurface and EGLContext, egl.h isn't included here since it drags in the platform's window system headers
+	void* m_display;
+	void* m_surface;
+	void* m_context;
+	bool m_isValid;
+};
+}
+
+#endif // LILAC_HEADLESS_CONTEXT_H
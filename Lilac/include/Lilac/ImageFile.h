@@ -0,0 +1,18 @@
+#ifndef LILAC_IMAGE_FILE_H
+#define LILAC_IMAGE_FILE_H
+
+#include <glm/vec2.hpp>
+
+#include <cstdint>
+#include <filesystem>
+
+namespace Lilac
+{
+// Binary PPM (P6), from RGBA8 rows bottom to top the way glGetTexImage returns them, alpha is dropped
+bool writePpm(const std::filesystem::path& path, glm::ivec2 size, const uint8_t* rgba);
+
+// Little endian PFM (PF), from RGBA32F rows bottom to top, PFM stores them in that order too, alpha is dropped
+bool writePfm(const std::filesystem::path& path, glm::ivec2 size, const float* rgba);
+}
+
+#endif // LILAC_IMAGE_FILE_H
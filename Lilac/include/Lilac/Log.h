@@ -0,0 +1,73 @@
+#ifndef LILAC_LOG_H
+#define LILAC_LOG_H
+
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+// Levels below this are compiled out, 0 trace, 1 debug, 2 info, 3 warning, 4 error, 5 nothing, see the CMake option
+#ifndef LILAC_LOG_MIN_LEVEL
+#define LILAC_LOG_MIN_LEVEL 2
+#endif
+
+namespace Lilac
+{
+enum class LogLevel
+{
+	Trace,
+	Debug,
+	Info,
+	Warning,
+	Error,
+	Off
+};
+
+// Leveled log lines, "seconds [level] category: message", errors go to std::cerr, the rest to the buffered std::clog
+// Use the LILAC_LOG_ macros, they only format the message if its level is enabled
+class Log
+{
+public:
+	// Runtime filter on top of LILAC_LOG_MIN_LEVEL, levels compiled out can't be turned back on
+	static void setLevel(LogLevel level);
+	[[nodiscard]] static LogLevel getLevel();
+
+	[[nodiscard]] static bool isEnabled(LogLevel level)
+	{
+		return level >= s_level;
+	}
+
+	// Only errors flush, so logging in a loop doesn't cost a write per line
+	static void write(LogLevel level, const char* category, const std::string& message);
+
+private:
+	static const char* getLevelName(LogLevel level);
+
+	static inline LogLevel s_level = LogLevel(LILAC_LOG_MIN_LEVEL);
+	static std::mutex s_mutex; // Lines from raycastBatch worker threads don't interleave
+	static const std::chrono::steady_clock::time_point s_start;
+};
+}
+
+// message is anything that can be streamed, e.g. "Compiled " << count << " shaders"
+#define LILAC_LOG(level, category, message) \
+	do \
+	{ \
+		if constexpr (int(level) >= LILAC_LOG_MIN_LEVEL) \
+		{ \
+			if (::Lilac::Log::isEnabled(level)) \
+			{ \
+				std::ostringstream lilacLogStream; \
+				lilacLogStream << message; \
+				::Lilac::Log::write(level, category, lilacLogStream.str()); \
+			} \
+		} \
+	} while (false)
+
+#define LILAC_LOG_TRACE(category, message) LILAC_LOG(::Lilac::LogLevel::Trace, category, message)
+#define LILAC_LOG_DEBUG(category, message) LILAC_LOG(::Lilac::LogLevel::Debug, category, message)
+#define LILAC_LOG_INFO(category, message) LILAC_LOG(::Lilac::LogLevel::Info, category, message)
+#define LILAC_LOG_WARNING(category, message) LILAC_LOG(::Lilac::LogLevel::Warning, category, message)
+#define LILAC_LOG_ERROR(category, message) LILAC_LOG(::Lilac::LogLevel::Error, category, message)
+
+#endif // LILAC_LOG_H
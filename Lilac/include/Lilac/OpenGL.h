@@ -4,4 +4,25 @@
 #include <GL/glew.h>
 #include <SFML3D/OpenGL.hpp>
 
+#include <algorithm>
+#include <string>
+
+namespace Lilac
+{
+// Vendor, renderer and version on one line, tells devices and driver updates apart for anything cached per device
+inline std::string getDriverString()
+{
+	auto getString = [](GLenum name) {
+		auto value = glGetString(name);
+		return value == nullptr ? std::string() : std::string(reinterpret_cast<const char*>(value));
+	};
+
+	auto driver = getString(GL_VENDOR) + " / " + getString(GL_RENDERER) + " / " + getString(GL_VERSION);
+
+	std::replace(driver.begin(), driver.end(), '\n', ' ');
+
+	return driver;
+}
+}
+
 #endif // LILAC_OPENGL_H
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef LILAC_PREPROCESSOR_H
+#define LILAC_PREPROCESSOR_H
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Lilac
+{
+// Single pass shader preprocessor, runs before the GLSL one
+// Handles #include, #pragma once, and object like #define/#undef, substituting macros as whole identifiers
+// outside of comments, so WORKGROUP_SIZE_X never touches WORKGROUP_SIZE_XY
+// Conditionals are evaluated once their macros are substituted, lines of branches not taken come out empty
+// Ones that can't be, through GL_ names or macros only the GLSL compiler knows, are left to it along with every
+// #define and #undef inside them
+class Preprocessor
+{
+public:
+	Preprocessor(std::map<std::string, std::string> macros, std::vector<std::filesystem::path> includeDirectories, int maxDepth);
+
+	// #include "file" is looked up next to the including file first, then in the include directories
+	[[nodiscard]] std::string process(std::string_view source);
+
+	// Macros given at construction plus every #define processed so far, outside of conditionals left to the GLSL compiler
+	[[nodiscard]] const std::map<std::string, std::string, std::less<>>& getMacros() const;
+
+	// Source string numbers used in #line directives, 0 is the source passed to process
+	[[nodiscard]] const std::vector<std::string>& getSourceNames() const;
+
+private:
+	struct Conditional
+	{
+		bool isEvaluated = true; // false once a condition can't be evaluated, the rest goes to the GLSL compiler
+		bool isActive = false; // Lines of the current branch are kept
+		bool isTaken = false; // Some branch so far was active
+		bool isParentActive = true;
+	};
+
+	void processSource(std::string_view source, const std::filesystem::path& path, int sourceIndex, int depth, std::string& output);
+	bool processDirective(std::string_view line, const std::filesystem::path& path, int sourceIndex, int lineNumber, int depth, std::string& output);
+	bool processConditional(std::string_view line, int depth, std::string& output);
+	void passCondition(std::string_view directive, std::string_view argument, int depth, std::string& output);
+	void processInclude(std::string_view argument, const std::filesystem::path& path, int sourceIndex, int lineNumber, int depth, std::string& output);
+
+	// Copies code to output with every macro identifier expanded, comments are copied as they are
+	void substitute(std::string_view code, int depth, std::string& output);
+	void expand(std::string_view name, int depth, std::string& output);
+
+	// Our macros become 1 in defined NAME and defined(NAME), other names 0 unless the GLSL compiler may know them
+	[[nodiscard]] std::string replaceDefined(std::string_view condition) const;
+	[[nodiscard]] bool evaluate(std::string_view condition, int depth, long long& value);
+	[[nodiscard]] bool isCompilerMacro(std::string_view name) const;
+	[[nodiscard]] bool isActive() const;
+
+	[[nodiscard]] bool isIncludeGuarded(std::string_view source) const;
+	[[nodiscard]] std::filesystem::path resolveInclude(std::string_view name, const std::filesystem::path& directory) const;
+
+	static std::string_view trim(std::string_view text);
+	static std::string_view readIdentifier(std::string_view text);
+	static bool isIdentifierStart(char c);
+	static bool isIdentifierChar(char c);
+
+	std::map<std::string, std::string, std::less<>> m_macros;
+	std::vector<std::filesystem::path> m_includeDirectories;
+	int m_maxDepth;
+
+	std::set<std::filesystem::path> m_onceFiles;
+	std::vector<std::string> m_sourceNames;
+	std::vector<std::string_view> m_expanding; // Macros being expanded, a macro never expands inside itself
+	std::vector<Conditional> m_conditionals; // Innermost last
+	std::set<std::string, std::less<>> m_compilerMacros; // Defined inside conditionals left to the GLSL compiler
+	bool m_isInBlockComment;
+};
+}
+
+#endif // LILAC_PREPROCESSOR_H
@@ -3,35 +3,143 @@
 
 #include <Lilac/OpenGL.h>
 #include <Lilac/Shader.h>
+#include <Lilac/ProgramBinaryCache.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <vector>
 
 namespace Lilac
 {
+class ShaderCompileQueue;
+
 class Program
 {
 public:
+	// Default uniform block member, reflected at link time
+	// Keep these around instead of the name to set uniforms without any lookup
+	struct Uniform
+	{
+		GLint location = -1; // -1 for uniforms that aren't active, setting those does nothing
+		GLenum type = GL_NONE;
+		GLint arraySize = 0;
+	};
+
+	// Uniform or shader storage block, reflected at link time
+	struct BufferBlock
+	{
+		GLint binding = -1;
+		GLint dataSize = 0; // For shader storage blocks this counts one element of the unsized array at the end
+		GLint fixedDataSize = 0; // dataSize without the unsized array, the least a buffer bound to it can hold
+	};
+
 	// TODO: Consider making these things virtual
 	GLuint getRawHandle() const;
 	void use() const;
 
+	// Programs built through a ShaderCompileQueue aren't usable until this is true
+	[[nodiscard]] bool isReady() const;
+	[[nodiscard]] bool isFailed() const;
+
+	// Advances the build as far as the driver allows without waiting, true once it is ready or failed
+	bool pollBuild();
+
+	// Waits for the rest of the build, true if it is ready
+	bool finishBuild();
+
+	[[nodiscard]] Uniform getUniform(const std::string& name) const;
+	[[nodiscard]] bool hasUniformBlock(const std::string& name) const;
+	[[nodiscard]] bool hasStorageBlock(const std::string& name) const;
+
+	// Reflected size of the block, 0 if the program doesn't use it, see BufferBlock::dataSize
+	[[nodiscard]] size_t getStorageBlockDataSize(const std::string& name) const;
+
+	// Checks the binding and size of a block against what the caller binds to it, printing any mismatch
+	// Blocks the program doesn't use pass, the driver may drop them
+	bool validateUniformBlock(const std::string& name, GLuint binding, size_t dataSize) const;
+	bool validateStorageBlock(const std::string& name, GLuint binding, size_t dataSize) const;
+
+	// Set through glProgramUniform, so the program doesn't have to be in use
+	void setUniform(Uniform uniform, GLint value);
+	void setUniform(Uniform uniform, GLuint value);
+	void setUniform(Uniform uniform, GLfloat value);
+	void setUniform(Uniform uniform, glm::ivec2 value);
+	void setUniform(Uniform uniform, glm::vec2 value);
+	void setUniform(Uniform uniform, glm::vec3 value);
+	void setUniform(Uniform uniform, glm::vec4 value);
+
+	// Convenience for setup code, looks the name up in the reflected uniforms first
+	template <typename T>
+	void setUniform(const std::string& name, T value)
+	{
+		setUniform(getUniform(name), value);
+	}
+
 	// TODO: make constructor private (I think?)
 	// TODO: make destructor
 
 protected:
+	enum class BuildState
+	{
+		Compiling,
+		Linking,
+		Ready,
+		Failed
+	};
+
 	GLuint m_handle;
 
-	void linkProgram();
+	BuildState m_buildState;
+	std::vector<Shader*> m_buildShaders; // Must outlive the build
+	const ProgramBinaryCache* m_cache;
+	uint64_t m_cacheKey;
+
+	std::map<std::string, Uniform> m_uniforms;
+	std::map<std::string, BufferBlock> m_uniformBlocks;
+	std::map<std::string, BufferBlock> m_storageBlocks;
+
+	Program();
+
+	// Loads the program from the cache when possible, otherwise submits the shader compiles
+	// pollBuild then links once they finish and stores the result in the cache
+	void startBuild(std::initializer_list<Shader*> shaders, const ProgramBinaryCache* cache);
+
+private:
+	bool advanceBuild(bool isBlocking);
+	bool isLinkFinished() const;
+	bool finishLink();
+
+	void reflect();
+	void reflectBlocks(GLenum programInterface, std::map<std::string, BufferBlock>& blocks);
+	GLint getFixedDataSize(GLuint storageBlockIndex, GLint dataSize) const;
+	std::string getResourceName(GLenum programInterface, GLuint index) const;
+
+	static bool validateBlock(
+		const std::map<std::string, BufferBlock>& blocks,
+		const char* kind,
+		const std::string& name,
+		GLuint binding,
+		size_t dataSize);
 };
 
 class RenderProgram : public Program
 {
 public:
-	RenderProgram(const VertexShader& vs, const FragmentShader& fs);
+	RenderProgram(VertexShader& vs, FragmentShader& fs, const ProgramBinaryCache* cache = nullptr);
+	RenderProgram(VertexShader& vs, FragmentShader& fs, ShaderCompileQueue& queue);
 };
 
 class ComputeProgram : public Program
 {
 public:
-	ComputeProgram(const ComputeShader& cs);
+	ComputeProgram(ComputeShader& cs, const ProgramBinaryCache* cache = nullptr);
+	ComputeProgram(ComputeShader& cs, ShaderCompileQueue& queue);
 
 	void dispatch(unsigned int x = 1, unsigned int y = 1, unsigned int z = 1);
 };
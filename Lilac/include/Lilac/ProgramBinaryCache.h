@@ -0,0 +1,47 @@
+#ifndef LILAC_PROGRAM_BINARY_CACHE_H
+#define LILAC_PROGRAM_BINARY_CACHE_H
+
+#include <Lilac/OpenGL.h>
+#include <Lilac/Shader.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace Lilac
+{
+// Linked program binaries on disk, one file per key, so warm starts skip compiling and linking
+// Keys hash the preprocessed sources, the macros and the driver, any of them changing just misses the cache
+class ProgramBinaryCache
+{
+public:
+	// Needs a current context, the driver strings are part of every key
+	explicit ProgramBinaryCache(std::filesystem::path directory);
+
+	[[nodiscard]] bool isSupported() const;
+
+	[[nodiscard]] uint64_t makeKey(const std::vector<const Shader*>& shaders) const;
+
+	// Loads into an unlinked program, false on a miss or if the driver rejects the binary
+	bool tryLoad(GLuint program, uint64_t key) const;
+
+	// The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+	void store(GLuint program, uint64_t key) const;
+
+private:
+	static constexpr uint32_t s_magic = 0x4C504243; // LPBC
+	static constexpr uint64_t s_fnvOffsetBasis = 14695981039346656037ull;
+	static constexpr uint64_t s_fnvPrime = 1099511628211ull;
+
+	static void hashString(uint64_t& hash, const std::string& value);
+
+	[[nodiscard]] std::filesystem::path getPath(uint64_t key) const;
+
+	std::filesystem::path m_directory;
+	std::string m_driver;
+	bool m_isSupported;
+};
+}
+
+#endif // LILAC_PROGRAM_BINARY_CACHE_H
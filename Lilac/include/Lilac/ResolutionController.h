@@ -0,0 +1,45 @@
+#ifndef LILAC_RESOLUTION_CONTROLLER_H
+#define LILAC_RESOLUTION_CONTROLLER_H
+
+#include <glm/vec2.hpp>
+
+#include <cstdint>
+
+namespace Lilac
+{
+// Scales the internal render resolution to keep the measured GPU frame time near a budget
+// Trace cost goes with the pixel count, so the scale per axis moves with the square root of the time ratio
+class ResolutionController
+{
+public:
+	ResolutionController(glm::ivec2 maxSize, float targetMilliseconds, float minScale);
+
+	// GPU time of a full image dispatch at the current size
+	void addFrameTime(float milliseconds);
+
+	[[nodiscard]] glm::ivec2 getSize() const;
+	[[nodiscard]] float getScale() const;
+
+	// Bumped every time the size changes, everything sized to the image has to start over
+	[[nodiscard]] uint64_t getRevision() const;
+
+private:
+	static constexpr unsigned int s_settleFrames = 8; // Frames to average after a change before deciding again
+	static constexpr float s_smoothing = 0.25f;
+	static constexpr float s_tolerance = 0.1f; // Fraction around the target that counts as on budget
+	static constexpr float s_maxStep = 1.25f; // Largest scale change per decision, either way
+
+	glm::ivec2 m_maxSize;
+	float m_targetMilliseconds;
+	float m_minScale;
+
+	float m_scale;
+	glm::ivec2 m_size;
+	uint64_t m_revision;
+
+	float m_averageMilliseconds;
+	unsigned int m_frameCount;
+};
+}
+
+#endif // LILAC_RESOLUTION_CONTROLLER_H
@@ -0,0 +1,37 @@
+#ifndef LILAC_SCENE_FILE_H
+#define LILAC_SCENE_FILE_H
+
+#include <Lilac/Camera.h>
+#include <Lilac/SparseVoxelOctree.h>
+
+#include <glm/vec3.hpp>
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace Lilac
+{
+// Voxels, camera and light read from a text file, one statement per line and # starts a comment
+//   voxel x y z material
+//   box minX minY minZ maxX maxY maxZ material, max is exclusive
+//   camera originX originY originZ forwardX forwardY forwardZ halfSize
+//   up x y z, the camera up, +y by default
+//   light red green blue
+// Anything left out keeps the default of the raytracer, except that an up parallel to forward is swapped for
+// the world axis furthest from it, so looking straight up or down still works
+struct SceneFile
+{
+	std::vector<SparseVoxelOctree::Voxel> voxels;
+	Camera camera;
+	glm::vec3 lightColor{ 1.0f, 0.0f, 0.0f }; // The light sits at the camera origin
+
+	// Empty if the file can't be read or a line doesn't parse, the line is logged
+	static std::optional<SceneFile> load(const std::filesystem::path& path);
+
+private:
+	static constexpr float s_minUpSine = 1e-3f; // Below this forward and up count as parallel
+};
+}
+
+#endif // LILAC_SCENE_FILE_H
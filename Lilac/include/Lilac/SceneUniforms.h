@@ -0,0 +1,37 @@
+#ifndef LILAC_SCENE_UNIFORMS_H
+#define LILAC_SCENE_UNIFORMS_H
+
+#include <Lilac/Camera.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+namespace Lilac
+{
+// std140 layout of the Scene uniform block in raytrace.cs.glsl, imageSize is padded out to a vec4 like the block
+struct SceneUniforms
+{
+	glm::vec4 cameraForward;
+	glm::vec4 cameraUp;
+	glm::vec4 cameraOriginHalfSize;
+	glm::vec4 lightPosition;
+	glm::vec4 lightColor;
+	glm::ivec2 imageSize;
+	glm::ivec2 padding{ 0, 0 };
+
+	SceneUniforms(const Camera& camera, glm::vec3 lightPosition, glm::vec3 lightColor, glm::ivec2 imageSize)
+		: cameraForward(camera.forward, 0.0f)
+		, cameraUp(camera.up, 0.0f)
+		, cameraOriginHalfSize(camera.origin, camera.halfSize)
+		, lightPosition(lightPosition, 1.0f)
+		, lightColor(lightColor, 1.0f)
+		, imageSize(imageSize)
+	{
+	}
+};
+
+static_assert(sizeof(SceneUniforms) == 6 * sizeof(glm::vec4), "SceneUniforms must match the std140 Scene block");
+}
+
+#endif // LILAC_SCENE_UNIFORMS_H
@@ -5,6 +5,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 namespace Lilac
 {
@@ -12,10 +13,24 @@ class Shader
 {
 public:
 	// TODO: Consider making these things virtual
+	// 0 until compileShader, programs loaded from the binary cache never compile their shaders
 	GLuint getRawHandle() const;
+	bool isCompiled() const;
+
+	const std::string& getProcessedSource() const;
+	const std::map<std::string, std::string>& getMacros() const;
 
 	// TODO: Get hot recompilation working
-	void compileShader(const std::string& source, const std::map<std::string, std::string>& macros);
+	// Compiles the source preprocessed at construction, does nothing the second time
+	bool compileShader();
+
+	// compileShader split in two, so many shaders can be handed to the driver before waiting on any of them
+	void submitCompile();
+	bool finishCompile(); // Blocks until the driver is done, unless isCompileFinished
+	[[nodiscard]] bool isCompileFinished() const; // Always true without parallel shader compile support
+
+	// GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile, lets compiles run on driver threads
+	static bool isParallelCompileSupported();
 	static std::string preprocessShader(const std::string& source, int maxDepth, const std::map<std::string, std::string>& macros);
 
 	// TODO: make constructor private (I think?)
@@ -23,8 +38,17 @@ public:
 
 protected:
 	GLuint m_handle;
+	GLenum m_type;
+	std::string m_processedSource;
+	std::vector<std::string> m_sourceNames; // Preprocessor::getSourceNames, to make sense of compile errors
+	std::map<std::string, std::string> m_macros;
+	bool m_isCompiled;
+	bool m_isCompileFinished;
+
+	Shader(GLenum type, const std::string& source, std::map<std::string, std::string> macros);
 
 	static const int s_maxDepth = 16;
+	static constexpr const char* s_includeDirectory = "resources/shaders";
 };
 
 class ComputeShader : public Shader
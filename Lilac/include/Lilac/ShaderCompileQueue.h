@@ -0,0 +1,44 @@
+#ifndef LILAC_SHADER_COMPILE_QUEUE_H
+#define LILAC_SHADER_COMPILE_QUEUE_H
+
+#include <Lilac/OpenGL.h>
+#include <Lilac/Program.h>
+#include <Lilac/ProgramBinaryCache.h>
+
+#include <vector>
+
+namespace Lilac
+{
+// Programs constructed with a queue only submit their shaders, the queue links them as the driver finishes
+// Poll it once per frame, or while loading, and use the programs once it reports them done
+// Without GL_KHR/ARB_parallel_shader_compile every poll compiles synchronously, exactly like before
+class ShaderCompileQueue
+{
+public:
+	// Needs a current context, asks the driver for as many compiler threads as it wants to use
+	explicit ShaderCompileQueue(const ProgramBinaryCache* cache = nullptr);
+
+	[[nodiscard]] const ProgramBinaryCache* getCache() const;
+
+	// The program must outlive the queue or be done building before it is destroyed
+	void add(Program& program);
+
+	// Advances every pending program without waiting, true once none are left
+	bool poll();
+
+	// Waits for every pending program
+	void finish();
+
+	// Any finished program failed to compile or link
+	[[nodiscard]] bool hasFailed() const;
+
+	[[nodiscard]] bool isParallel() const;
+
+private:
+	const ProgramBinaryCache* m_cache;
+	std::vector<Program*> m_pending;
+	bool m_hasFailed;
+};
+}
+
+#endif // LILAC_SHADER_COMPILE_QUEUE_H
@@ -4,8 +4,11 @@
 #include <Lilac/OpenGL.h>
 #include <glm/vec3.hpp>
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <span>
 #include <vector>
 #include <map>
 #include <functional>
@@ -21,17 +24,105 @@ public:
 		uint16_t materialId;
 	};
 
+	struct Ray
+	{
+		glm::vec3 origin;
+		glm::vec3 direction;
+		float maxDistance = std::numeric_limits<float>::infinity();
+		bool anyHit = false; // Occlusion test: stop at the first solid leaf and skip the face/material lookup
+	};
+
+	// faceIndex follows the aabb_normals convention of raytrace.cs.glsl: +x, -x, +y, -y, +z, -z
+	struct Hit
+	{
+		bool isHit = false;
+		float distance = 0.0f;
+		int faceIndex = -1;
+		glm::vec3 normal{ 0.0f, 0.0f, 0.0f };
+		uint16_t materialId = 0;
+	};
+
+	struct Bounds
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+
+	struct FlattenOptions
+	{
+		bool ropes = false; // Append per node face neighbor links for stackless traversal
+		uint32_t topGridResolution = 0; // Append a dense grid of subtree roots, 0 for none, clamped to the root scale
+	};
+
+	// Header flags
+	static constexpr GLuint s_flattenedRopes = 1 << 0;
+	static constexpr GLuint s_flattenedTopGrid = 1 << 1;
+
+	// Sizes of the flattened sections in GLuint words, node indices count parents first, then leaves
+	static constexpr size_t s_flattenedHeaderWords = 8;
+	static constexpr size_t s_flattenedParentWords = 12;
+	static constexpr size_t s_flattenedLeafWords = 4;
+	static constexpr size_t s_flattenedRopeWords = 8;
+	static constexpr size_t s_flattenedTopGridHeaderWords = 4;
+	static constexpr GLuint s_flattenedNoNode = 0xFFFFFFFF;
+
 	SparseVoxelOctree(glm::vec3 min, const std::vector<Voxel>& voxels);
 
+	// Overwrites existing voxels, voxels must be inside the octree bounds given at construction
+	void setVoxels(const std::vector<Voxel>& voxels);
+
+	// Bumped by every modification, compare against a stored revision to know when to re-flatten
+	[[nodiscard]] uint64_t getRevision() const;
+
+	// World space union of every voxel written by setVoxels since the last clearDirtyBounds
+	// Anything outside of it looks the same as before, so only the part of the image it covers has to be traced again
+	[[nodiscard]] bool hasDirtyBounds() const;
+	[[nodiscard]] Bounds getDirtyBounds() const;
+	void clearDirtyBounds();
+
 	// Vector of indices, min, scale, materialId
 	// Do we want this walk to hit non-leaf nodes as well
 	void walk(const std::function<void(std::vector<size_t>, glm::vec3, uint16_t, uint16_t)>& func);
 
 	// Buffer format is
-	// [Header: uint subtree_count, uint voxel_count, uint scale16u, uint padding, vec4 min]
-	// [Subtree[subtree_count]: vec4 min_scale16u, uint[8] children_indices] // vec4*3
+	// [Header: uint subtree_count, uint voxel_count, uint scale16u, uint flags, vec4 min]
+	// [Subtree[subtree_count]: vec4 min_scale16u, uint[8] children_indices] // vec4*3, breadth first from the root
 	// [Voxel[voxel_count]: vec4 min_materialId16u_scale16u] // vec4*1
+	// [Rope[subtree_count + voxel_count]: uint[6] face_neighbor_indices, uint[2] padding] // vec4*2, only with s_flattenedRopes
+	// [TopGrid: uint resolution, float cell_size, uint[2] padding, uint[resolution^3] cells] // only with s_flattenedTopGrid
+	// Ropes are indexed by node index and follow the aabb_normals face order, a rope points at the smallest
+	// node that is at least as large as its own node and shares the face, or s_flattenedNoNode outside the root
+	// Top grid cells are x major and hold the smallest node containing the cell, or s_flattenedNoNode if it is empty
 	[[nodiscard]] std::vector<std::byte> flatten() const; // TODO: Figure out if we need to do endianness stuff here, maybe use unique pointer here?
+	[[nodiscard]] std::vector<std::byte> flatten(const FlattenOptions& options) const;
+
+	// Stack based traversal of a flattened buffer, this is what the compute shader does
+	[[nodiscard]] static Hit raycastFlattened(std::span<const std::byte> flattened, const Ray& ray);
+
+	// Stackless traversal of a flattened buffer with ropes, goes leaf to leaf by following the exit face ropes
+	[[nodiscard]] static Hit raycastFlattenedRopes(std::span<const std::byte> flattened, const Ray& ray);
+
+	// DDA through the top grid of a flattened buffer, with stack based traversal of each non-empty cell
+	[[nodiscard]] static Hit raycastFlattenedTopGrid(std::span<const std::byte> flattened, const Ray& ray);
+
+	// Closest hit against non-empty (materialId != 0) leaves, children are visited front to back
+	// Rays starting inside a solid leaf hit at distance 0
+	[[nodiscard]] Hit raycast(const Ray& ray) const;
+
+	// Writes hits[i] for rays[i], hits must be at least as large as rays
+	// Large batches are split across hardware threads, the octree must not be modified meanwhile
+	void raycastBatch(std::span<const Ray> rays, std::span<Hit> hits) const;
+
+	// Material of the leaf containing the voxel, 0 if it is empty or outside the octree
+	[[nodiscard]] uint16_t getMaterialId(uint16_t x, uint16_t y, uint16_t z) const;
+
+	// Shared memory the compute shader uses to cache the parents of the top levels, see OCTREE_SHARED_LEVELS in octree.glsl
+	[[nodiscard]] static size_t getSharedLevelsBytes(int levels);
+
+	// The most top levels, up to `levels`, whose parents fit in maxBytes, GL_MAX_COMPUTE_SHARED_MEMORY_SIZE for the shader
+	[[nodiscard]] static int clampSharedLevels(int levels, size_t maxBytes);
+
+	static glm::vec3 faceIndexToNormal(int faceIndex);
 
 private:
 	struct Node
@@ -49,6 +140,16 @@ private:
 		[[nodiscard]] bool isChildrenHomogenous() const;
 	};
 
+	bool raycastNode(const Node* node, const Ray& ray, glm::vec3 inverseDirection, size_t octantMask, Hit& hit) const;
+	static bool intersectAabb(
+		glm::vec3 min,
+		glm::vec3 max,
+		glm::vec3 origin,
+		glm::vec3 inverseDirection,
+		float& tNear,
+		float& tFar,
+		int& nearAxis);
+
 	void walk_internal(const std::function<void(std::vector<size_t>, glm::vec3, uint16_t, uint16_t)>& func, Node* node, std::vector<size_t> indices);
 
 	void addVoxels(const std::vector<Voxel>& voxels);
@@ -60,10 +161,10 @@ private:
 	void collapseNode(Node* parent, size_t childIndex, Node* node);
 
 	static glm::vec3 octantIndexToOffset(size_t i);
-	static size_t globalPositionToChildIndex(Node* node, uint16_t x, uint16_t y, uint16_t z);
+	static size_t globalPositionToChildIndex(const Node* node, uint16_t x, uint16_t y, uint16_t z);
 
 	void gatherNodes(
-		Node* current,
+		Node* root,
 		std::map<Node*, size_t>& parent_to_index,
 		std::map<Node*, size_t>& leaf_to_index,
 		std::vector<Node*>& parents,
@@ -72,6 +173,7 @@ private:
 
 	void flattenedWriteHeader(
 		std::vector<std::byte>& vec,
+		GLuint flags,
 		const std::vector<Node*>& parents,
 		const std::vector<Node*>& leaves) const;
 
@@ -85,12 +187,52 @@ private:
 		std::vector<std::byte>& vec,
 		const std::vector<Node*>& leaves);
 
+	static void gatherRopes(
+		Node* node,
+		const std::array<Node*, 6>& ropes,
+		std::map<Node*, std::array<Node*, 6>>& nodeToRopes);
+
+	static void flattenedWriteRopes(
+		std::vector<std::byte>& vec,
+		const std::map<Node*, size_t>& parentToIndex,
+		const std::map<Node*, size_t>& leafToIndex,
+		const std::vector<Node*>& parents,
+		const std::vector<Node*>& leaves,
+		const std::map<Node*, std::array<Node*, 6>>& nodeToRopes);
+
+	void flattenedWriteTopGrid(
+		std::vector<std::byte>& vec,
+		uint32_t resolution,
+		const std::map<Node*, size_t>& parentToIndex,
+		const std::map<Node*, size_t>& leafToIndex,
+		size_t parentCount) const;
+
+	static bool raycastFlattenedNode(std::span<const std::byte> flattened, const Ray& ray, GLuint root, Hit& hit);
+
+	static GLuint flattenedNodeIndex(
+		Node* node,
+		const std::map<Node*, size_t>& parentToIndex,
+		const std::map<Node*, size_t>& leafToIndex,
+		size_t parentCount);
+
+	static size_t flattenedNodeOffset(std::span<const std::byte> flattened, GLuint node);
+	static size_t flattenedTopGridOffset(std::span<const std::byte> flattened);
+	static GLuint readGLuint(std::span<const std::byte> vec, size_t wordIndex);
+	static GLfloat readFloat(std::span<const std::byte> vec, size_t wordIndex);
+	static glm::vec3 readVec3(std::span<const std::byte> vec, size_t wordIndex);
+
 	static void pushFloat(std::vector<std::byte>& vec, GLfloat x);
 	static void pushGLuint(std::vector<std::byte>& vec, GLuint x);
 	static void pushUint16(std::vector<std::byte>& vec, uint16_t x);
 	static void pushVec3AsVec4(std::vector<std::byte>& vec, glm::vec3 x);
 	static void pushBytes(std::vector<std::byte>& vec, std::byte const* x, size_t byte_count);
 
+	static constexpr size_t s_minRaysPerThread = 256;
+	static constexpr size_t s_traversalStackSize = 128; // 7 pushes per level of a 16 level tree, plus the root
+
+	uint64_t m_revision;
+	bool m_hasDirtyBounds;
+	Bounds m_dirtyBounds;
 	Node* m_head; // TODO: Figure some way to not recompute the gl buffer for every modification?
 };
 }
@@ -0,0 +1,54 @@
+#ifndef LILAC_THREAD_POOL_H
+#define LILAC_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Lilac
+{
+// Worker threads started once and kept waiting, so per frame parallel work doesn't pay for thread startup
+// One parallelFor runs at a time, calls from other threads wait for it
+class ThreadPool
+{
+public:
+	explicit ThreadPool(size_t workerCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Runs task(i) for every i in [0, count) on the workers and the calling thread, returns once every one finished
+	void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+	// Workers and the calling thread
+	[[nodiscard]] size_t getThreadCount() const;
+
+	// One worker less than there are hardware threads, the caller is the last one, started on first use
+	static ThreadPool& getShared();
+
+private:
+	void work();
+	void drain(const std::function<void(size_t)>& task, size_t count);
+
+	std::vector<std::thread> m_workers;
+	std::mutex m_runMutex; // Serializes parallelFor
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	const std::function<void(size_t)>* m_task;
+	size_t m_count;
+	std::atomic<size_t> m_next; // Next index to claim
+	size_t m_activeWorkers; // Workers that joined the current run and haven't left it yet
+	uint64_t m_generation;
+	bool m_isStopping;
+};
+}
+
+#endif // LILAC_THREAD_POOL_H
@@ -0,0 +1,44 @@
+#ifndef LILAC_TILE_MASK_H
+#define LILAC_TILE_MASK_H
+
+#include <Lilac/OpenGL.h>
+#include <Lilac/Camera.h>
+#include <Lilac/SparseVoxelOctree.h>
+
+#include <glm/vec2.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Lilac
+{
+// Marks which workgroup tiles of the image have to be traced again, for dispatching only part of the screen
+class TileMask
+{
+public:
+	TileMask(glm::ivec2 imageSize, glm::ivec2 tileSize);
+
+	void clear();
+
+	// Marks every tile the screen space projection of bounds touches
+	// Returns how many tiles it touches, counting ones that were already marked, 0 if it is entirely off screen
+	size_t markBounds(const Camera& camera, const SparseVoxelOctree::Bounds& bounds);
+
+	[[nodiscard]] size_t getMarkedCount() const;
+	[[nodiscard]] size_t getTileCount() const;
+
+	// Marked tiles packed as x | y << 16 in tile units, one workgroup is dispatched per entry
+	[[nodiscard]] std::vector<GLuint> getMarkedTiles() const;
+
+private:
+	glm::ivec2 m_imageSize;
+	glm::ivec2 m_tileSize;
+	glm::ivec2 m_tileCount;
+
+	std::vector<uint8_t> m_mask;
+	size_t m_markedCount;
+};
+}
+
+#endif // LILAC_TILE_MASK_H
@@ -0,0 +1,76 @@
+#ifndef LILAC_TRACE_H
+#define LILAC_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Lilac
+{
+// Scoped CPU zones, recorded into a ring per thread and written as Chrome trace JSON
+// Open the file in chrome://tracing or ui.perfetto.dev
+// Use the LILAC_TRACE_ macros below, they compile to nothing unless LILAC_ENABLE_TRACING is defined
+class Trace
+{
+public:
+	// Names must outlive the trace, string literals in practice
+	class Zone
+	{
+	public:
+		explicit Zone(const char* name);
+		~Zone();
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+		const char* m_name;
+		int64_t m_startNanoseconds;
+	};
+
+	static void record(const char* name, int64_t startNanoseconds, int64_t durationNanoseconds);
+
+	// Every zone recorded so far, on all threads, zones still being recorded while writing may be torn
+	static bool writeJson(const std::filesystem::path& path);
+
+	[[nodiscard]] static int64_t now();
+
+private:
+	static constexpr size_t s_eventCapacity = 1 << 16; // Per thread, the oldest events are overwritten
+
+	struct Event
+	{
+		const char* name;
+		int64_t startNanoseconds;
+		int64_t durationNanoseconds;
+	};
+
+	struct ThreadBuffer
+	{
+		std::vector<Event> events; // Grows up to s_eventCapacity, then is used as a ring
+		size_t next = 0;
+		uint32_t threadId = 0;
+	};
+
+	// Registered on first use, so buffers of finished threads are still written out
+	static ThreadBuffer& getThreadBuffer();
+
+	static std::mutex s_mutex;
+	static std::vector<std::shared_ptr<ThreadBuffer>> s_buffers;
+};
+}
+
+#ifdef LILAC_ENABLE_TRACING
+#define LILAC_TRACE_CONCAT_INNER(a, b) a##b
+#define LILAC_TRACE_CONCAT(a, b) LILAC_TRACE_CONCAT_INNER(a, b)
+#define LILAC_TRACE_SCOPE(name) ::Lilac::Trace::Zone LILAC_TRACE_CONCAT(lilacTraceZone, __LINE__){ name }
+#define LILAC_TRACE_WRITE(path) ::Lilac::Trace::writeJson(path)
+#else
+#define LILAC_TRACE_SCOPE(name) ((void)0)
+#define LILAC_TRACE_WRITE(path) ((void)0)
+#endif
+
+#endif // LILAC_TRACE_H
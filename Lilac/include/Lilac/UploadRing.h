@@ -0,0 +1,49 @@
+#ifndef LILAC_UPLOAD_RING_H
+#define LILAC_UPLOAD_RING_H
+
+#include <Lilac/OpenGL.h>
+
+#include <array>
+#include <cstddef>
+
+namespace Lilac
+{
+// Staging memory for buffer uploads, one persistently mapped buffer split into a region per frame in flight
+// Data is written straight into the mapping and copied into its buffer on the GPU, so the CPU fills the next frame
+// while the GPU still reads the previous ones, a fence per region guards against overwriting what isn't copied yet
+// Needs GL 4.4 or ARB_buffer_storage, without it, or for uploads larger than a region, glBufferSubData is used instead
+class UploadRing
+{
+public:
+	explicit UploadRing(size_t frameBytes);
+	~UploadRing();
+
+	UploadRing(const UploadRing&) = delete;
+	UploadRing& operator=(const UploadRing&) = delete;
+
+	[[nodiscard]] bool isPersistent() const;
+
+	// Copies the data into the buffer at the offset, the buffer must already be large enough
+	void upload(GLuint buffer, GLintptr offset, const void* data, size_t size);
+
+	// Fences the uploads of this frame, call once the commands reading them are submitted
+	void endFrame();
+
+private:
+	// Waits until the GPU is done with the region of this frame, usually long ago
+	void beginFrame();
+
+	static constexpr size_t s_frameCount = 3;
+	static constexpr size_t s_alignment = 16;
+
+	GLuint m_buffer;
+	std::byte* m_mapping; // nullptr without persistent mapping
+	size_t m_frameBytes;
+	size_t m_frame;
+	size_t m_used; // Bytes of the current region
+	bool m_isFrameBegun;
+	std::array<GLsync, s_frameCount> m_fences;
+};
+}
+
+#endif // LILAC_UPLOAD_RING_H
@@ -0,0 +1,53 @@
+#ifndef LILAC_WORK_GROUP_TUNER_H
+#define LILAC_WORK_GROUP_TUNER_H
+
+#include <Lilac/OpenGL.h>
+#include <Lilac/Program.h>
+#include <Lilac/ComputeVariantCache.h>
+
+#include <glm/vec2.hpp>
+
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Lilac
+{
+// Picks the compute workgroup size by timing a few candidates on the device itself
+// The winner is stored per device in a small text file, later starts on the same device just load it
+class WorkGroupTuner
+{
+public:
+	// Binds whatever the program reads and dispatches the benchmark, with workgroups of the given size
+	using Dispatch = std::function<void(ComputeProgram& program, glm::ivec2 workGroupSize)>;
+
+	// Needs a current context, the driver strings identify the device
+	explicit WorkGroupTuner(std::filesystem::path resultsPath);
+
+	// The size stored for this device, if it was ever tuned
+	[[nodiscard]] std::optional<glm::ivec2> load() const;
+	void store(glm::ivec2 workGroupSize) const;
+
+	// Sizes within the device limits, between s_minInvocations and s_maxInvocations and not too narrow
+	[[nodiscard]] static std::vector<glm::ivec2> getCandidates();
+
+	// Builds every candidate as a WORKGROUP_SIZE_X/Y variant of the features and times the dispatch of each
+	// Blocks until done, the fastest candidate is returned, empty if none of them could be timed
+	// Dispatches are timed by timer queries, or by the wall clock around glFinish where those read nothing
+	[[nodiscard]] std::optional<glm::ivec2> tune(ComputeVariantCache& variants, ComputeVariantCache::Features features, const Dispatch& dispatch) const;
+
+private:
+	static constexpr int s_minInvocations = 32;
+	static constexpr int s_maxInvocations = 256;
+	static constexpr int s_maxAspectRatio = 4;
+	static constexpr int s_warmupDispatches = 2;
+	static constexpr int s_timedDispatches = 5; // The fastest one counts, the others are noise from the rest of the system
+
+	std::filesystem::path m_resultsPath;
+	std::string m_device;
+};
+}
+
+#endif // LILAC_WORK_GROUP_TUNER_H
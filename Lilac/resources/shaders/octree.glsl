@@ -0,0 +1,376 @@
+// Flattened octree traversal, shared by the compute shaders, see SparseVoxelOctree::flatten for the layout
+// Needs OCTREE_TRAVERSAL, OCTREE_SHARED_LEVELS, OCTREE_TOP_GRID and DEBUG_COUNTERS defined, and a compute shader for the shared memory cache
+#pragma once
+
+layout(std430, binding = 2) readonly buffer Octree
+{
+	uint octree[]; // See SparseVoxelOctree::flatten
+};
+
+#define TRAVERSAL_STACK 0
+#define TRAVERSAL_ROPES 1
+
+#if DEBUG_COUNTERS
+uint debug_node_visits = 0u; // Nodes, cells and rope steps visited by this invocation, summed up by the including shader
+#define DEBUG_COUNT_NODE_VISIT() debug_node_visits++
+#else
+#define DEBUG_COUNT_NODE_VISIT()
+#endif
+
+struct OctreeHit
+{
+	float t;
+	int face_index;
+	uint material_id; // 0 is a miss
+};
+
+
+const int face_right = 0;
+const int face_left = 1;
+const int face_up = 2;
+const int face_down = 3;
+const int face_front = 4;
+const int face_back = 5;
+
+const vec3 inf3 = vec3(1.0) / vec3(0.0);
+const vec3 neg_inf3 = vec3(-1.0) / vec3(0.0);
+
+const float inf = 1.0 / 0.0;
+const float neg_inf = -1.0 / 0.0;
+
+const vec3 aabb_normals[6] = vec3[6](
+	vec3(1.0, 0.0, 0.0),
+	vec3(-1.0, 0.0, 0.0),
+	vec3(0.0, 1.0, 0.0),
+	vec3(0.0, -1.0, 0.0),
+	vec3(0.0, 0.0, 1.0),
+	vec3(0.0, 0.0, -1.0)
+);
+
+// Flattened octree layout, in uints
+const uint octree_header_size = 8u;
+const uint octree_parent_size = 12u;
+const uint octree_leaf_size = 4u;
+const uint octree_rope_size = 8u;
+const uint octree_top_grid_header_size = 4u;
+const uint octree_no_node = 0xFFFFFFFFu;
+
+// Header flags
+const uint octree_flag_ropes = 1u;
+
+const int octree_stack_size = 128; // 7 pushes per level of a 16 level tree, plus the root
+
+#if OCTREE_SHARED_LEVELS > 0
+// Parents are stored breadth first, so the top levels are the first (8^levels - 1) / 7 parents at most
+const uint octree_shared_parent_count = ((1u << (3u * uint(OCTREE_SHARED_LEVELS))) - 1u) / 7u;
+
+// The host clamps the levels to what fits in GL_MAX_COMPUTE_SHARED_MEMORY_SIZE, see SparseVoxelOctree::clampSharedLevels
+shared uint octree_shared[octree_shared_parent_count * octree_parent_size];
+#endif
+
+
+float min3(vec3 v)
+{
+	return min(min(v.x, v.y), v.z);
+}
+
+float max3(vec3 v)
+{
+	return max(max(v.x, v.y), v.z);
+}
+
+int argmax(vec3 v)
+{
+	bool xy = v.x >= v.y;
+	bool xz = v.x >= v.z;
+	bool yz = v.y >= v.z;
+
+	bool ybig = yz && !xy;
+	bool zbig = !(xz || yz);
+
+	return 1 * int(ybig) + 2 * int(zbig);
+}
+
+int argmin(vec3 v)
+{
+	return argmax(-v);
+}
+
+
+// https://tavianator.com/2011/ray_box.html
+// The weird seeming min(max(x, neg_inf)) stuff is to prevent the issue
+// where 0.0 * inf = NaN, and NaN's are propigated based on the first argument 
+// in standard implementations
+// see: https://tavianator.com/2022/ray_box_boundary.html
+// Kept per axis, traversals need to know which slab was entered or exited
+void intersect_slabs(vec3 box_min, vec3 box_max, vec3 ray_origin, vec3 ray_inverse_direction, out vec3 t_near_vec, out vec3 t_far_vec)
+{
+	vec3 t_box_min = (box_min - ray_origin) * ray_inverse_direction;
+	vec3 t_box_max = (box_max - ray_origin) * ray_inverse_direction;
+
+	t_near_vec = min(max(t_box_min, neg_inf), max(t_box_max, neg_inf));
+	t_far_vec = max(min(t_box_min, inf), min(t_box_max, inf));
+}
+
+vec3 octree_read_vec3(uint offset)
+{
+	return uintBitsToFloat(uvec3(octree[offset], octree[offset + 1u], octree[offset + 2u]));
+}
+
+// Must be called from uniform control flow, every invocation of the workgroup takes a slice of the copy
+void octree_load_shared()
+{
+#if OCTREE_SHARED_LEVELS > 0
+	uint shared_words = min(octree[0], octree_shared_parent_count) * octree_parent_size;
+	uint invocation_count = gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z;
+
+	for (uint i = gl_LocalInvocationIndex; i < shared_words; i += invocation_count)
+	{
+		octree_shared[i] = octree[octree_header_size + i];
+	}
+
+	memoryBarrierShared();
+	barrier();
+#endif
+}
+
+// word is relative to the start of the parent, see SparseVoxelOctree::flatten
+uint octree_parent_word(uint node, uint word)
+{
+#if OCTREE_SHARED_LEVELS > 0
+	if (node < octree_shared_parent_count)
+	{
+		return octree_shared[octree_parent_size * node + word];
+	}
+#endif
+
+	return octree[octree_header_size + octree_parent_size * node + word];
+}
+
+vec3 octree_parent_min(uint node)
+{
+	return uintBitsToFloat(uvec3(octree_parent_word(node, 0u), octree_parent_word(node, 1u), octree_parent_word(node, 2u)));
+}
+
+// Node indices count parents first, then leaves
+uint octree_node_offset(uint node)
+{
+	uint parent_count = octree[0];
+
+	return node < parent_count
+		? octree_header_size + octree_parent_size * node
+		: octree_header_size + octree_parent_size * parent_count + octree_leaf_size * (node - parent_count);
+}
+
+// Front to back traversal with an explicit stack, stops at the first solid leaf.
+// Children are culled against the ray before being pushed, so only nodes the ray actually passes through are read.
+OctreeHit trace_octree_stack(uint root, vec3 ray_origin, vec3 ray_direction, vec3 ray_inverse_direction, float t_max)
+{
+	OctreeHit hit = OctreeHit(t_max, -1, 0u);
+
+	uint parent_count = octree[0];
+	uint octant_mask = uint(ray_direction.x < 0.0) + 2u * uint(ray_direction.y < 0.0) + 4u * uint(ray_direction.z < 0.0);
+
+	uint stack[octree_stack_size];
+	int stack_size = 0;
+	stack[stack_size++] = root;
+
+	vec3 t_near_vec;
+	vec3 t_far_vec;
+
+	while (stack_size > 0)
+	{
+		DEBUG_COUNT_NODE_VISIT();
+		uint node = stack[--stack_size];
+
+		if (node < parent_count)
+		{
+			vec3 node_min = octree_parent_min(node);
+			float half_scale = float(octree_parent_word(node, 3u)) / 2.0;
+
+			// Push back to front so the nearest child is popped first
+			for (uint i = 8u; i > 0u; i--)
+			{
+				uint child_index = (i - 1u) ^ octant_mask;
+				vec3 child_min = node_min + half_scale * vec3(child_index & 1u, (child_index >> 1) & 1u, child_index >> 2);
+
+				intersect_slabs(child_min, child_min + half_scale, ray_origin, ray_inverse_direction, t_near_vec, t_far_vec);
+
+				float t_near = max3(t_near_vec);
+				float t_far = min3(t_far_vec);
+
+				if (t_far >= t_near && t_far >= 0.0 && t_near <= t_max)
+				{
+					stack[stack_size++] = octree_parent_word(node, 4u + child_index);
+				}
+			}
+
+			continue;
+		}
+
+		uint offset = octree_node_offset(node);
+		uint material_scale = octree[offset + 3u];
+		uint material_id = material_scale & 0xFFFFu;
+
+		if (material_id != 0u)
+		{
+			vec3 leaf_min = octree_read_vec3(offset);
+			intersect_slabs(leaf_min, leaf_min + float(material_scale >> 16), ray_origin, ray_inverse_direction, t_near_vec, t_far_vec);
+
+			int near_axis = argmax(t_near_vec);
+			hit = OctreeHit(max(t_near_vec[near_axis], 0.0), 2 * near_axis + int(ray_direction[near_axis] > 0.0), material_id);
+			break;
+		}
+	}
+
+	return hit;
+}
+
+// DDA through the top grid, then stack based traversal inside each non-empty cell, needs a buffer flattened with a top grid.
+// Cells are visited in ray order and a solid leaf spanning several cells is hit in the first one, so the first hit wins.
+OctreeHit trace_octree_top_grid(vec3 ray_origin, vec3 ray_direction, vec3 ray_inverse_direction, float t_max)
+{
+	OctreeHit hit = OctreeHit(t_max, -1, 0u);
+
+	uint parent_count = octree[0];
+	uint leaf_count = octree[1];
+	uint grid_offset = octree_header_size + octree_parent_size * parent_count + octree_leaf_size * leaf_count;
+
+	if ((octree[3] & octree_flag_ropes) != 0u)
+	{
+		grid_offset += octree_rope_size * (parent_count + leaf_count);
+	}
+
+	int resolution = int(octree[grid_offset]);
+	float cell_size = uintBitsToFloat(octree[grid_offset + 1u]);
+	uint cells_offset = grid_offset + octree_top_grid_header_size;
+
+	vec3 grid_min = octree_read_vec3(4u);
+	vec3 grid_max = grid_min + float(octree[2]);
+
+	vec3 t_near_vec;
+	vec3 t_far_vec;
+	intersect_slabs(grid_min, grid_max, ray_origin, ray_inverse_direction, t_near_vec, t_far_vec);
+
+	float t_near = max3(t_near_vec);
+	float t_far = min3(t_far_vec);
+
+	if (t_far < t_near || t_far < 0.0)
+	{
+		return hit;
+	}
+
+	float t = max(t_near, 0.0);
+	vec3 start = (ray_origin + ray_direction * t - grid_min) / cell_size;
+
+	bvec3 is_parallel = equal(ray_direction, vec3(0.0));
+	ivec3 cell = clamp(ivec3(floor(start)), ivec3(0), ivec3(resolution - 1));
+	ivec3 cell_step = ivec3(sign(ray_direction));
+	vec3 next_plane = grid_min + (vec3(cell) + step(0.0, ray_direction)) * cell_size;
+	vec3 t_next = mix((next_plane - ray_origin) * ray_inverse_direction, inf3, is_parallel);
+	vec3 t_delta = mix(abs(cell_size * ray_inverse_direction), inf3, is_parallel);
+
+	while (t <= t_max)
+	{
+		DEBUG_COUNT_NODE_VISIT();
+		uint node = octree[cells_offset + uint(cell.x + resolution * (cell.y + resolution * cell.z))];
+
+		if (node != octree_no_node)
+		{
+			hit = trace_octree_stack(node, ray_origin, ray_direction, ray_inverse_direction, t_max);
+
+			if (hit.material_id != 0u)
+			{
+				break;
+			}
+		}
+
+		int axis = argmin(t_next);
+
+		t = t_next[axis];
+		cell[axis] += cell_step[axis];
+
+		if (cell[axis] < 0 || cell[axis] >= resolution)
+		{
+			break;
+		}
+
+		t_next[axis] += t_delta[axis];
+	}
+
+	return hit;
+}
+
+// Stackless traversal, needs a buffer flattened with ropes.
+// Descends from the current node to the leaf containing the current point, then follows the rope of the face
+// the ray exits through. Exit faces always point along the ray, so t never goes backwards.
+OctreeHit trace_octree_ropes(vec3 ray_origin, vec3 ray_direction, vec3 ray_inverse_direction, float t_max)
+{
+	OctreeHit hit = OctreeHit(t_max, -1, 0u);
+
+	uint parent_count = octree[0];
+	uint ropes_offset = octree_header_size + octree_parent_size * parent_count + octree_leaf_size * octree[1];
+
+	vec3 root_min = octree_read_vec3(4u);
+	vec3 root_max = root_min + float(octree[2]);
+
+	vec3 t_near_vec;
+	vec3 t_far_vec;
+	intersect_slabs(root_min, root_max, ray_origin, ray_inverse_direction, t_near_vec, t_far_vec);
+
+	float t_near = max3(t_near_vec);
+	float t_far = min3(t_far_vec);
+
+	if (t_far < t_near || t_far < 0.0)
+	{
+		return hit;
+	}
+
+	float t = max(t_near, 0.0);
+	uint node = 0u;
+
+	while (t <= t_max)
+	{
+		DEBUG_COUNT_NODE_VISIT();
+		vec3 position = ray_origin + ray_direction * t;
+
+		while (node < parent_count)
+		{
+			DEBUG_COUNT_NODE_VISIT();
+			vec3 center = octree_parent_min(node) + float(octree_parent_word(node, 3u)) / 2.0;
+			uvec3 is_upper = uvec3(greaterThanEqual(position, center));
+
+			node = octree_parent_word(node, 4u + is_upper.x + 2u * is_upper.y + 4u * is_upper.z);
+		}
+
+		uint offset = octree_node_offset(node);
+		uint material_scale = octree[offset + 3u];
+		vec3 leaf_min = octree_read_vec3(offset);
+		vec3 leaf_max = leaf_min + float(material_scale >> 16);
+
+		intersect_slabs(leaf_min, leaf_max, ray_origin, ray_inverse_direction, t_near_vec, t_far_vec);
+
+		uint material_id = material_scale & 0xFFFFu;
+
+		if (material_id != 0u)
+		{
+			int near_axis = argmax(t_near_vec);
+			hit = OctreeHit(t, 2 * near_axis + int(ray_direction[near_axis] > 0.0), material_id);
+			break;
+		}
+
+		int exit_axis = argmin(t_far_vec);
+		int exit_face = 2 * exit_axis + int(ray_direction[exit_axis] < 0.0);
+
+		node = octree[ropes_offset + octree_rope_size * node + uint(exit_face)];
+
+		if (node == octree_no_node)
+		{
+			break;
+		}
+
+		t = max(t, t_far_vec[exit_axis]);
+	}
+
+	return hit;
+}
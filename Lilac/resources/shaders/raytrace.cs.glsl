@@ -1,107 +1,69 @@
 #version 430
 
+// Each workgroup is a tile of pixels, one invocation per pixel
 layout(local_size_x = WORKGROUP_SIZE_X, local_size_y = WORKGROUP_SIZE_Y, local_size_z = WORKGROUP_SIZE_Z) in;
 
-struct AABB
-{
-	vec4 min;
-	vec4 max;
-};
+const ivec2 supersample_count = ivec2(SUPERSAMPLE_X, SUPERSAMPLE_Y);
 
-layout(std430, binding = 0) buffer Pixels
+// Updated once per frame from the CPU, see SceneUniforms
+layout(std140, binding = 0) uniform Scene
 {
-	vec4 colors[];
+	vec4 camera_forward; // Normalized
+	vec4 camera_up;
+	vec4 camera_origin; // w is the orthographic half size, in world units
+	vec4 light_position;
+	vec4 light_color;
+	ivec2 image_size; // Render resolution, can be smaller than the images, which are allocated at the largest one
 };
 
-layout(std430, binding = 1) buffer InputAABBs
-{
-	AABB input_aabbs[];
-};
-
-
-const int face_right = 0;
-const int face_left = 1;
-const int face_up = 2;
-const int face_down = 3;
-const int face_front = 4;
-const int face_back = 5;
-
-const vec3 inf3 = vec3(1.0) / vec3(0.0);
-const vec3 neg_inf3 = vec3(-1.0) / vec3(0.0);
+layout(binding = 0, OUTPUT_FORMAT) writeonly uniform image2D output_image;
 
-const float inf = 1.0 / 0.0;
-const float neg_inf = -1.0 / 0.0;
+#if PROGRESSIVE
+// Running sum of the per frame colors, frame_index is how many frames it already holds
+layout(binding = 1, rgba32f) uniform image2D accumulation_image;
+uniform uint frame_index;
+#endif
 
-const vec3 aabb_normals[6] = vec3[6](
-	vec3(1.0, 0.0, 0.0),
-	vec3(-1.0, 0.0, 0.0),
-	vec3(0.0, 1.0, 0.0),
-	vec3(0.0, -1.0, 0.0),
-	vec3(0.0, 0.0, 1.0),
-	vec3(0.0, 0.0, -1.0)
-);
-
-
-float min3(vec3 v)
+// With use_tile_list the dispatch is one dimensional, one workgroup per listed tile instead of a grid over the image
+layout(std430, binding = 3) readonly buffer TileList
 {
-	return min(min(v.x, v.y), v.z);
-}
+	uint tile_list[]; // x | y << 16 in tiles, see TileMask::getMarkedTiles
+};
 
-float max3(vec3 v)
-{
-	return max(max(v.x, v.y), v.z);
-}
+uniform bool use_tile_list;
 
-int argmax(vec3 v)
+#if DEBUG_COUNTERS
+// Totals since the CPU last cleared the buffer
+layout(std430, binding = 4) buffer Counters
 {
-	bool xy = v.x >= v.y;
-	bool xz = v.x >= v.z;
-	bool yz = v.y >= v.z;
-
-	bool ybig = yz && !xy;
-	bool zbig = !(xz || yz);
-
-	return 1 * int(ybig) + 2 * int(zbig);
-}
+	uint counter_rays;
+	uint counter_node_visits;
+};
+#endif
 
+#include "octree.glsl"
 
-// https://tavianator.com/2011/ray_box.html
-// The weird seeming min(max(x, neg_inf)) stuff is to prevent the issue
-// where 0.0 * inf = NaN, and NaN's are propigated based on the first argument 
-// in standard implementations
-// see: https://tavianator.com/2022/ray_box_boundary.html
-float intersect_aabb(AABB aabb, vec3 ray_origin, vec3 ray_inverse_direction)
+// https://www.reedbeta.com/blog/hash-functions-for-gpu-rendering/
+uint hash_pcg(uint v)
 {
-	vec3 t_aabb_min = (aabb.min.xyz - ray_origin) * ray_inverse_direction;
-	vec3 t_aabb_max = (aabb.max.xyz - ray_origin) * ray_inverse_direction;
-
-	vec3 t_near_vec = min(max(t_aabb_min, neg_inf), max(t_aabb_max, neg_inf));
-	vec3 t_far_vec = max(min(t_aabb_min, inf), min(t_aabb_max, inf));
-
-	float t_near = max3(t_near_vec);
-	float t_far = min3(t_far_vec);
+	uint state = v * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
 
-	float is_hit = float(t_far >= t_near && t_far >= 0); // >= allows for corners to return true (t_near and t_far would be equal in this case)
-	float is_near_behind = float(t_near <= 0);
-	float is_near_in_front = float(t_near > 0);
-
-	float t_hit = is_hit * (t_near * is_near_in_front + t_far * is_near_behind); // hit is near if in front, else use t_far
-
-	return t_hit;
+	return (word >> 22u) ^ word;
 }
 
-int get_face_index(vec3 p)
+// Uniform in [0, 1)^2, different for every pixel, frame and sample
+vec2 sample_jitter(ivec2 pixel, uint frame, uint sample_index)
 {
-	int axis_index = argmax(abs(p));
-	int face_index = 2*axis_index + int(p[axis_index] < 0);
+	uint seed = hash_pcg(uint(pixel.x) + hash_pcg(uint(pixel.y) + hash_pcg(frame * 256u + sample_index)));
 
-	return face_index;
+	return vec2(seed & 0xFFFFu, seed >> 16) / 65536.0;
 }
 
-vec3 pixel_coords_to_camera_coords(vec2 pixel_coords, vec2 image_size, vec3 camera_forward, vec3 camera_up, vec3 camera_origin)
+vec3 pixel_coords_to_camera_coords(vec2 pixel_coords, vec2 image_size, vec3 camera_forward, vec3 camera_up, vec3 camera_origin, float camera_half_size)
 {
 	vec2 half_image_size = image_size / 2.0;
-	vec2 local_coords_v2 = (pixel_coords - half_image_size) / half_image_size;
+	vec2 local_coords_v2 = camera_half_size * (pixel_coords - half_image_size) / half_image_size;
 	vec3 local_coords = vec3(local_coords_v2, 0.0);
 
 	vec3 camera_right = cross(camera_forward, camera_up);
@@ -111,70 +73,95 @@ vec3 pixel_coords_to_camera_coords(vec2 pixel_coords, vec2 image_size, vec3 came
 	return camera_coords;
 }
 
-vec4 get_aabb_center(AABB aabb)
-{
-	return (aabb.min + aabb.max) / 2.0;
-}
 
-vec4 get_aabb_extents(AABB aabb)
+vec3 trace_sample(vec2 pixel_coords)
 {
-	return aabb.max - aabb.min;
-}
+	vec3 ray_direction = camera_forward.xyz;
+	vec3 ray_inv_direction = 1.0 / ray_direction;
+	vec3 ray_origin = pixel_coords_to_camera_coords(pixel_coords, vec2(image_size), camera_forward.xyz, camera_up.xyz, camera_origin.xyz, camera_origin.w);
 
+	float t_hit = 1000000; // TODO: Make max value for raytracer
 
-// Simple update
-void main() {
-	// get index in global work group i.e x,y position
-	uint work_group_size = gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z;
-	vec2 pixel_coords = vec2(gl_WorkGroupID.xy) + vec2(gl_LocalInvocationID.xy) / vec2(gl_WorkGroupSize.xy);
+#if OCTREE_TOP_GRID
+	OctreeHit octree_hit = trace_octree_top_grid(ray_origin, ray_direction, ray_inv_direction, t_hit);
+#elif OCTREE_TRAVERSAL == TRAVERSAL_ROPES
+	OctreeHit octree_hit = trace_octree_ropes(ray_origin, ray_direction, ray_inv_direction, t_hit);
+#else
+	OctreeHit octree_hit = trace_octree_stack(0u, ray_origin, ray_direction, ray_inv_direction, t_hit);
+#endif
 
-	vec3 camera_forward = normalize(vec3(-1.0, -1.0, -1.0));
-	vec3 camera_up = normalize(vec3(0.0, 1.0, 0.0));
-	vec3 camera_origin = vec3(2.0, 2.0, 2.0);
+	bool is_hit = octree_hit.material_id != 0u;
+	t_hit = octree_hit.t;
+	int face_index = octree_hit.face_index;
 
-	vec3 ray_direction = camera_forward;
-	vec3 ray_inv_direction = 1.0 / ray_direction;
-	vec3 ray_origin = pixel_coords_to_camera_coords(pixel_coords, gl_NumWorkGroups.xy, camera_forward, camera_up, camera_origin);
+	vec3 color = vec3(0.0);
+
+	if (is_hit)
+	{
+		vec3 hit_absolute = ray_origin + ray_direction * t_hit;
+		vec3 face_normal = aabb_normals[face_index];
+		vec3 to_light = normalize(light_position.xyz - hit_absolute);
 
-	vec3 light_position = camera_origin;
-	vec3 light_color = vec3(1.0, 0.0, 0.0);
+		color += clamp(dot(face_normal, to_light) * light_color.rgb, 0.0, 1.0);
+	}
 
-	float t_hit = 1000000; // TODO: Make max value for raytracer
-	int hit_index = -1;
+	return color;
+}
 
-	for (int i = 0; i < INPUT_AABB_SIZE_X * INPUT_AABB_SIZE_Y; i++)
-	{
-		AABB box = input_aabbs[i];
 
-		float t_hit_box = intersect_aabb(box, ray_origin, ray_inv_direction);
-		bool is_closer = t_hit_box > 0 && t_hit_box < t_hit;
+void main() {
+	// Before the bounds check, every invocation has to reach the barrier
+	octree_load_shared();
+
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+
+	if (use_tile_list)
+	{
+		uint tile = tile_list[gl_WorkGroupID.x];
+		pixel = ivec2(tile & 0xFFFFu, tile >> 16u) * ivec2(gl_WorkGroupSize.xy) + ivec2(gl_LocalInvocationID.xy);
+	}
 
-		t_hit = float(!is_closer) * t_hit + float(is_closer) * t_hit_box;
-		hit_index = int(!is_closer) * hit_index + int(is_closer) * i;
+	// The last row and column of tiles can hang over the edge of the image
+	if (any(greaterThanEqual(pixel, image_size)))
+	{
+		return;
 	}
 
 	vec3 color = vec3(0.0);
 
-	if (hit_index > -1)
+	for (int y = 0; y < supersample_count.y; y++)
 	{
-		AABB hit_aabb = input_aabbs[hit_index];
-		vec3 center = get_aabb_center(hit_aabb).xyz;
-		vec3 extents = get_aabb_extents(hit_aabb).xyz;
+		for (int x = 0; x < supersample_count.x; x++)
+		{
+#if PROGRESSIVE
+			// Jittered inside each stratum, so every frame adds new sample positions
+			vec2 offset = vec2(x, y) + sample_jitter(pixel, frame_index, uint(x + y * supersample_count.x));
+#else
+			vec2 offset = vec2(x, y);
+#endif
+			vec2 pixel_coords = vec2(pixel) + offset / vec2(supersample_count);
+			color += trace_sample(pixel_coords);
+		}
+	}
 
-		vec3 hit_absolute = ray_origin + ray_direction * t_hit;
-		vec3 hit_relative = hit_absolute - center;
-		vec3 hit_normalized = hit_relative / extents;
+	color /= float(supersample_count.x * supersample_count.y);
 
-		int face_index = get_face_index(hit_normalized);
-		vec3 face_normal = aabb_normals[face_index];
-		vec3 to_light = normalize(light_position - hit_absolute);
+#if PROGRESSIVE
+	vec3 accumulated = color;
 
-		color += clamp(dot(face_normal, to_light) * light_color, 0.0, 1.0);
+	if (frame_index > 0u)
+	{
+		accumulated += imageLoad(accumulation_image, pixel).rgb;
 	}
 
-	vec4 pixel = vec4(color, 1.0);
+	imageStore(accumulation_image, pixel, vec4(accumulated, 1.0));
+	color = accumulated / float(frame_index + 1u);
+#endif
+
+	imageStore(output_image, pixel, vec4(color, 1.0));
 
-	uint pixel_index = gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x;
-	uint local_index = gl_LocalInvocationID.x + gl_LocalInvocationID.y * gl_WorkGroupSize.x;
-	colors[work_group_size*pixel_index + local_index] = pixel;
-}
\ No newline at end of file
+#if DEBUG_COUNTERS
+	atomicAdd(counter_rays, uint(supersample_count.x * supersample_count.y));
+	atomicAdd(counter_node_visits, debug_node_visits);
+#endif
+}
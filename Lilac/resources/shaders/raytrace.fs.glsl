@@ -1,32 +1,13 @@
 #version 430
-layout(std430, binding = 0) buffer Pixels
-{
-	vec4 colors[]; // Should match compute shader
-};
-const ivec2 image_size = ivec2(IMAGE_SIZE_X, IMAGE_SIZE_Y);
-const ivec3 work_group_size = ivec3(WORKGROUP_SIZE_X, WORKGROUP_SIZE_Y, WORKGROUP_SIZE_Z);
-const uint work_group_total_size = work_group_size.x * work_group_size.y * work_group_size.z;
+layout(binding = 0) uniform sampler2D output_texture; // Written by the compute shader, samples are already resolved
+uniform ivec2 output_size; // Part of output_texture that was rendered, from its lower left corner
 
 in vec2 v_tex_coord;
 out vec4 frag_color;
 
 void main() 
 {
-	// vec2 frag_coord = floor(gl_FragCoord.xy * image_size / vec2(512, 512));
-	vec2 frag_coord = floor(image_size * v_tex_coord - 0.001f); // Subtract 0.001f because we go from 0..1 inclusive
-	ivec2 frag_coord_ivec = ivec2(frag_coord);
-	
-	uint index = uint(work_group_total_size * (frag_coord_ivec.x + frag_coord_ivec.y * image_size.x));
-	frag_color = vec4(0.0, 0.0, 0.0, 1.0);
-
-	// frag_color.r = index / float(image_size.x * image_size.y);
-	// frag_color.rg = frag_coord.xy / vec2(image_size);
-
-	// frag_color = colors[index];
-
-	float weight = 1.0 / float(work_group_total_size);
-	for (int i = 0; i < work_group_total_size; i++)
-	{
-		frag_color += weight * colors[index + i];
-	}
+	// Bilinear upscale of the rendered part, clamped to its texel centers so nothing bleeds in from outside of it
+	vec2 texel_coords = clamp(v_tex_coord * vec2(output_size), vec2(0.5), vec2(output_size) - 0.5);
+	frag_color = texture(output_texture, texel_coords / vec2(textureSize(output_texture, 0)));
 }
\ No newline at end of file
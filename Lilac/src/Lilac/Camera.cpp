@@ -0,0 +1,30 @@
+#include <Lilac/Camera.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+
+
+glm::vec2 Lilac::Camera::worldToPixelCoords(glm::vec3 position, glm::vec2 imageSize) const
+{
+	// Same basis as the shader, right and local up aren't unit length unless forward and up are perpendicular
+	glm::vec3 right = glm::cross(forward, up);
+	glm::vec3 localUp = glm::cross(right, forward);
+
+	glm::vec3 offset = position - origin;
+	glm::vec2 localCoords(
+		glm::dot(offset, right) / glm::dot(right, right),
+		glm::dot(offset, localUp) / glm::dot(localUp, localUp));
+
+	glm::vec2 halfImageSize = imageSize / 2.0f;
+
+	return localCoords / halfSize * halfImageSize + halfImageSize;
+}
+
+void Lilac::Camera::pan(glm::vec2 offset)
+{
+	glm::vec3 right = glm::normalize(glm::cross(forward, up));
+	glm::vec3 localUp = glm::cross(right, forward);
+
+	origin += right * offset.x + localUp * offset.y;
+}
@@ -0,0 +1,92 @@
+#include <Lilac/ComputeVariantCache.h>
+#include <Lilac/Log.h>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+
+Lilac::ComputeVariantCache::ComputeVariantCache(std::string source, std::map<std::string, std::string> baseMacros, ShaderCompileQueue& queue)
+	: m_source(std::move(source))
+	, m_baseMacros(std::move(baseMacros))
+	, m_queue(queue)
+{
+}
+
+void Lilac::ComputeVariantCache::prepare(const Features& features)
+{
+	getVariant(features);
+}
+
+Lilac::ComputeProgram* Lilac::ComputeVariantCache::tryGet(const Features& features)
+{
+	auto& variant = getVariant(features);
+
+	// The queue may not have been polled yet this frame
+	variant.program->pollBuild();
+
+	return variant.program->isReady() ? variant.program.get() : nullptr;
+}
+
+Lilac::ComputeProgram* Lilac::ComputeVariantCache::get(const Features& features)
+{
+	auto& variant = getVariant(features);
+
+	return variant.program->finishBuild() ? variant.program.get() : nullptr;
+}
+
+bool Lilac::ComputeVariantCache::isFailed(const Features& features) const
+{
+	auto found = m_variants.find(features);
+
+	return found != m_variants.end() && found->second.program->isFailed();
+}
+
+size_t Lilac::ComputeVariantCache::getVariantCount() const
+{
+	return m_variants.size();
+}
+
+std::string Lilac::ComputeVariantCache::formatFeatures(const Features& features)
+{
+	std::string text;
+
+	for (const auto& [name, value] : features)
+	{
+		text += " " + name + "=" + value;
+	}
+
+	return text;
+}
+
+std::map<std::string, std::string> Lilac::ComputeVariantCache::getMacros(const Features& features) const
+{
+	auto macros = m_baseMacros;
+
+	for (const auto& [name, value] : features)
+	{
+		macros.insert_or_assign(name, value);
+	}
+
+	return macros;
+}
+
+Lilac::ComputeVariantCache::Variant& Lilac::ComputeVariantCache::getVariant(const Features& features)
+{
+	auto found = m_variants.find(features);
+
+	if (found != m_variants.end())
+	{
+		return found->second;
+	}
+
+	LILAC_LOG_INFO("ComputeVariantCache", "Building variant" << formatFeatures(features));
+
+	Variant variant;
+	variant.shader = std::make_unique<ComputeShader>(m_source, getMacros(features));
+	variant.program = std::make_unique<ComputeProgram>(*variant.shader, m_queue);
+
+	return m_variants.emplace(features, std::move(variant)).first->second;
+}
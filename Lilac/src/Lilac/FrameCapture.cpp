@@ -0,0 +1,169 @@
+#include <Lilac/FrameCapture.h>
+#include <Lilac/ImageFile.h>
+#include <Lilac/Trace.h>
+#include <Lilac/Log.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+
+
+Lilac::FrameCapture::FrameCapture()
+	: m_slots{}
+	, m_oldest(0)
+	, m_pendingCount(0)
+	, m_failedCount(0)
+	, m_framebuffer(0)
+{
+	glGenFramebuffers(1, &m_framebuffer);
+
+	for (auto& slot : m_slots)
+	{
+		glGenBuffers(1, &slot.buffer);
+	}
+}
+
+Lilac::FrameCapture::~FrameCapture()
+{
+	for (auto& slot : m_slots)
+	{
+		if (slot.fence != nullptr)
+		{
+			glDeleteSync(slot.fence);
+		}
+
+		glDeleteBuffers(1, &slot.buffer);
+	}
+
+	glDeleteFramebuffers(1, &m_framebuffer);
+}
+
+bool Lilac::FrameCapture::capture(GLuint texture, glm::ivec2 size, Format format, std::filesystem::path path)
+{
+	if (m_pendingCount == s_slotCount)
+	{
+		LILAC_LOG_WARNING("FrameCapture", "Every slot is in flight, skipping " << path);
+		m_failedCount++;
+		return false;
+	}
+
+	auto& slot = m_slots[(m_oldest + m_pendingCount) % s_slotCount];
+	bool isFloat = format == Format::Pfm;
+	size_t byteCount = size_t(size.x) * size.y * 4 * (isFloat ? sizeof(float) : sizeof(uint8_t));
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+
+	// Only grows, captures are usually all the same size
+	if (byteCount > slot.capacity)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, byteCount, nullptr, GL_STREAM_READ);
+		slot.capacity = byteCount;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+	// Compute shader image writes have to land before the copy reads them
+	glMemoryBarrier(GL_PIXEL_BUFFER_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	// With a pack buffer bound this only queues the copy, the pointer is an offset into the buffer
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, isFloat ? GL_FLOAT : GL_UNSIGNED_BYTE, nullptr);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.size = size;
+	slot.format = format;
+	slot.path = std::move(path);
+	m_pendingCount++;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	return true;
+}
+
+void Lilac::FrameCapture::poll()
+{
+	while (m_pendingCount > 0 && writeOldest(false))
+	{
+	}
+}
+
+void Lilac::FrameCapture::finish()
+{
+	while (m_pendingCount > 0)
+	{
+		writeOldest(true);
+	}
+}
+
+size_t Lilac::FrameCapture::getPendingCount() const
+{
+	return m_pendingCount;
+}
+
+size_t Lilac::FrameCapture::getFailedCount() const
+{
+	return m_failedCount;
+}
+
+bool Lilac::FrameCapture::writeOldest(bool isBlocking)
+{
+	auto& slot = m_slots[m_oldest];
+
+	// Flushing makes sure the fence is ever signaled, even if nothing else is submitted while waiting
+	GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, isBlocking ? GL_TIMEOUT_IGNORED : 0);
+
+	if (status == GL_TIMEOUT_EXPIRED)
+	{
+		return false;
+	}
+
+	LILAC_TRACE_SCOPE("write capture");
+
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+	m_oldest = (m_oldest + 1) % s_slotCount;
+	m_pendingCount--;
+
+	if (status == GL_WAIT_FAILED)
+	{
+		LILAC_LOG_ERROR("FrameCapture", "Waiting on the copy failed, skipping " << slot.path);
+		m_failedCount++;
+		return true;
+	}
+
+	bool isFloat = slot.format == Format::Pfm;
+	size_t byteCount = size_t(slot.size.x) * slot.size.y * 4 * (isFloat ? sizeof(float) : sizeof(uint8_t));
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, byteCount, GL_MAP_READ_BIT);
+
+	if (pixels == nullptr)
+	{
+		LILAC_LOG_ERROR("FrameCapture", "Failed to map the pixels of " << slot.path);
+		m_failedCount++;
+	}
+	else
+	{
+		std::error_code error;
+		std::filesystem::create_directories(slot.path.parent_path(), error);
+
+		bool isWritten = isFloat
+			? writePfm(slot.path, slot.size, static_cast<const float*>(pixels))
+			: writePpm(slot.path, slot.size, static_cast<const uint8_t*>(pixels));
+
+		if (!isWritten)
+		{
+			m_failedCount++;
+		}
+
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	return true;
+}
@@ -0,0 +1,89 @@
+#include <Lilac/FrameScheduler.h>
+#include <Lilac/Trace.h>
+
+#include <SFML3D/System.hpp>
+
+#include <cstdint>
+
+
+Lilac::FrameScheduler::FrameScheduler(sf3d::Time targetFrameTime, unsigned int maxAccumulatedFrames)
+	: m_targetFrameTime(targetFrameTime)
+	, m_maxAccumulatedFrames(maxAccumulatedFrames)
+	, m_accumulatedFrames(0)
+	, m_sceneRevision(0)
+	, m_cameraRevision(0)
+	, m_hasRevisions(false)
+	, m_isPresentRequested(false)
+{
+}
+
+void Lilac::FrameScheduler::update(uint64_t sceneRevision, uint64_t cameraRevision)
+{
+	if (!m_hasRevisions || sceneRevision != m_sceneRevision || cameraRevision != m_cameraRevision)
+	{
+		m_sceneRevision = sceneRevision;
+		m_cameraRevision = cameraRevision;
+		m_hasRevisions = true;
+
+		restart();
+	}
+}
+
+void Lilac::FrameScheduler::restart()
+{
+	m_accumulatedFrames = 0;
+}
+
+bool Lilac::FrameScheduler::shouldDispatch() const
+{
+	return !isConverged();
+}
+
+bool Lilac::FrameScheduler::isConverged() const
+{
+	return m_accumulatedFrames >= m_maxAccumulatedFrames;
+}
+
+bool Lilac::FrameScheduler::shouldPresent() const
+{
+	return m_isPresentRequested;
+}
+
+bool Lilac::FrameScheduler::isIdle() const
+{
+	return !shouldDispatch() && !shouldPresent();
+}
+
+unsigned int Lilac::FrameScheduler::getAccumulatedFrames() const
+{
+	return m_accumulatedFrames;
+}
+
+void Lilac::FrameScheduler::onDispatched()
+{
+	m_accumulatedFrames++;
+	m_isPresentRequested = true;
+}
+
+void Lilac::FrameScheduler::onPresented()
+{
+	m_isPresentRequested = false;
+}
+
+void Lilac::FrameScheduler::requestPresent()
+{
+	m_isPresentRequested = true;
+}
+
+void Lilac::FrameScheduler::paceFrame()
+{
+	sf3d::Time elapsed = m_frameClock.getElapsedTime();
+
+	if (!isIdle() && elapsed < m_targetFrameTime)
+	{
+		LILAC_TRACE_SCOPE("FrameScheduler::sleep");
+		sf3d::sleep(m_targetFrameTime - elapsed);
+	}
+
+	m_frameClock.restart();
+}
@@ -0,0 +1,131 @@
+#include <Lilac/GpuProfiler.h>
+#include <Lilac/Log.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+Lilac::GpuProfiler::Scope::Scope(GpuProfiler& profiler, const std::string& pass)
+	: m_profiler(profiler)
+	, m_pass(pass)
+{
+	m_profiler.begin(m_pass);
+}
+
+Lilac::GpuProfiler::Scope::~Scope()
+{
+	m_profiler.end(m_pass);
+}
+
+void Lilac::GpuProfiler::begin(const std::string& pass)
+{
+	// Constructed in place, the timer can't be moved
+	m_passes.try_emplace(pass).first->second.timer.begin();
+}
+
+void Lilac::GpuProfiler::end(const std::string& pass)
+{
+	auto found = m_passes.find(pass);
+
+	if (found != m_passes.end())
+	{
+		found->second.timer.end();
+	}
+}
+
+void Lilac::GpuProfiler::collect()
+{
+	for (auto& [name, pass] : m_passes)
+	{
+		pass.collected.clear();
+		float milliseconds = 0.0f;
+
+		while (pass.timer.tryGetElapsed(milliseconds))
+		{
+			pass.collected.push_back(milliseconds);
+
+			if (pass.samples.size() < s_windowSize)
+			{
+				pass.samples.push_back(milliseconds);
+			}
+			else
+			{
+				pass.samples[pass.nextSample] = milliseconds;
+			}
+
+			pass.nextSample = (pass.nextSample + 1) % s_windowSize;
+		}
+	}
+}
+
+const std::vector<float>& Lilac::GpuProfiler::getCollected(const std::string& pass) const
+{
+	static const std::vector<float> none;
+
+	auto found = m_passes.find(pass);
+	return found == m_passes.end() ? none : found->second.collected;
+}
+
+Lilac::GpuProfiler::Stats Lilac::GpuProfiler::getStats(const std::string& pass) const
+{
+	auto found = m_passes.find(pass);
+
+	if (found == m_passes.end() || found->second.samples.empty())
+	{
+		return {};
+	}
+
+	auto samples = found->second.samples;
+	std::sort(samples.begin(), samples.end());
+
+	Stats stats;
+	stats.sampleCount = samples.size();
+	stats.minMilliseconds = samples.front();
+
+	for (float sample : samples)
+	{
+		stats.averageMilliseconds += sample;
+	}
+
+	stats.averageMilliseconds /= float(samples.size());
+
+	// Nearest rank, with few samples this is just the slowest one
+	size_t p99Index = std::min(samples.size() - 1, (samples.size() * 99 + 99) / 100 - 1);
+	stats.p99Milliseconds = samples[p99Index];
+
+	return stats;
+}
+
+void Lilac::GpuProfiler::print(std::ostream& stream) const
+{
+	for (const auto& [name, pass] : m_passes)
+	{
+		auto stats = getStats(name);
+
+		stream << std::fixed << std::setprecision(3)
+			<< name << ": min " << stats.minMilliseconds
+			<< " ms, avg " << stats.averageMilliseconds
+			<< " ms, p99 " << stats.p99Milliseconds
+			<< " ms over " << stats.sampleCount << " samples" << std::defaultfloat << "\n";
+	}
+}
+
+bool Lilac::GpuProfiler::writeFile(const std::filesystem::path& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	print(file);
+
+	if (!file)
+	{
+		LILAC_LOG_WARNING("GpuProfiler", "Failed to write " << path);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,72 @@
+#include <Lilac/GpuTimer.h>
+
+#include <cstddef>
+
+
+Lilac::GpuTimer::GpuTimer()
+	: m_queries{}
+	, m_oldest(0)
+	, m_pendingCount(0)
+	, m_isTiming(false)
+{
+	glGenQueries(GLsizei(m_queries.size()), m_queries.data());
+}
+
+Lilac::GpuTimer::~GpuTimer()
+{
+	glDeleteQueries(GLsizei(m_queries.size()), m_queries.data());
+}
+
+void Lilac::GpuTimer::begin()
+{
+	if (m_isTiming || m_pendingCount == s_queryPairCount)
+	{
+		return;
+	}
+
+	size_t pair = (m_oldest + m_pendingCount) % s_queryPairCount;
+	glQueryCounter(m_queries[2 * pair], GL_TIMESTAMP);
+	m_isTiming = true;
+}
+
+void Lilac::GpuTimer::end()
+{
+	if (!m_isTiming)
+	{
+		return;
+	}
+
+	size_t pair = (m_oldest + m_pendingCount) % s_queryPairCount;
+	glQueryCounter(m_queries[2 * pair + 1], GL_TIMESTAMP);
+	m_pendingCount++;
+	m_isTiming = false;
+}
+
+bool Lilac::GpuTimer::tryGetElapsed(float& milliseconds)
+{
+	if (m_pendingCount == 0)
+	{
+		return false;
+	}
+
+	// The end timestamp is written after the begin one
+	GLint isAvailable = GL_FALSE;
+	glGetQueryObjectiv(m_queries[2 * m_oldest + 1], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+
+	if (!isAvailable)
+	{
+		return false;
+	}
+
+	GLuint64 beginNanoseconds = 0;
+	GLuint64 endNanoseconds = 0;
+	glGetQueryObjectui64v(m_queries[2 * m_oldest], GL_QUERY_RESULT, &beginNanoseconds);
+	glGetQueryObjectui64v(m_queries[2 * m_oldest + 1], GL_QUERY_RESULT, &endNanoseconds);
+
+	m_oldest = (m_oldest + 1) % s_queryPairCount;
+	m_pendingCount--;
+
+	// Some drivers only have coarse timestamps, a section can come out empty but never negative
+	milliseconds = endNanoseconds > beginNanoseconds ? float((endNanoseconds - beginNanoseconds) / 1e6) : 0.0f;
+	return true;
+}
@@ -0,0 +1,156 @@
+#include <Lilac/HeadlessContext.h>
+#include <Lilac/Log.h>
+
+// Only the surfaceless and default platforms are used, keep Xlib and its macros out
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <string>
+
+
+namespace
+{
+bool hasExtension(const char* extensions, const char* name)
+{
+	if (extensions == nullptr)
+	{
+		return false;
+	}
+
+	// Space separated, a plain strstr would also match prefixes of longer names
+	std::string padded = std::string(" ") + extensions + " ";
+	return padded.find(std::string(" ") + name + " ") != std::string::npos;
+}
+}
+
+Lilac::HeadlessContext::HeadlessContext()
+	: m_display(EGL_NO_DISPLAY)
+	, m_surface(EGL_NO_SURFACE)
+	, m_context(EGL_NO_CONTEXT)
+	, m_isValid(false)
+{
+	m_isValid = create();
+}
+
+Lilac::HeadlessContext::~HeadlessContext()
+{
+	if (m_display == EGL_NO_DISPLAY)
+	{
+		return;
+	}
+
+	eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	if (m_context != EGL_NO_CONTEXT)
+	{
+		eglDestroyContext(m_display, m_context);
+	}
+
+	if (m_surface != EGL_NO_SURFACE)
+	{
+		eglDestroySurface(m_display, m_surface);
+	}
+
+	eglTerminate(m_display);
+}
+
+bool Lilac::HeadlessContext::isValid() const
+{
+	return m_isValid;
+}
+
+bool Lilac::HeadlessContext::create()
+{
+	// Client extensions are queried without a display, EGL 1.4 implementations return null here
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+	if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless") && hasExtension(clientExtensions, "EGL_EXT_platform_base"))
+	{
+		auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+		if (getPlatformDisplay != nullptr)
+		{
+			m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		}
+	}
+
+	if (m_display == EGL_NO_DISPLAY)
+	{
+		m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major = 0, minor = 0;
+
+	if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, &major, &minor))
+	{
+		LILAC_LOG_ERROR("HeadlessContext", "Failed to initialize an EGL display, error 0x" << std::hex << eglGetError());
+		return false;
+	}
+
+	LILAC_LOG_INFO("HeadlessContext", "EGL " << major << "." << minor << ", " << eglQueryString(m_display, EGL_VENDOR));
+
+	bool isSurfaceless = hasExtension(eglQueryString(m_display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_NONE
+	};
+
+	EGLConfig config = nullptr;
+	EGLint configCount = 0;
+
+	if (!eglChooseConfig(m_display, configAttributes, &config, 1, &configCount) || configCount == 0)
+	{
+		LILAC_LOG_ERROR("HeadlessContext", "No EGL config with desktop OpenGL and pbuffer support");
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		LILAC_LOG_ERROR("HeadlessContext", "EGL can't create desktop OpenGL contexts");
+		return false;
+	}
+
+	// Compute shaders and shader storage buffers, what the raytracer needs at the least
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, contextAttributes);
+
+	if (m_context == EGL_NO_CONTEXT)
+	{
+		LILAC_LOG_ERROR("HeadlessContext", "Failed to create an OpenGL 4.3 core context, error 0x" << std::hex << eglGetError());
+		return false;
+	}
+
+	if (!isSurfaceless)
+	{
+		const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		m_surface = eglCreatePbufferSurface(m_display, config, surfaceAttributes);
+
+		if (m_surface == EGL_NO_SURFACE)
+		{
+			LILAC_LOG_ERROR("HeadlessContext", "Failed to create a pbuffer surface, error 0x" << std::hex << eglGetError());
+			return false;
+		}
+	}
+
+	if (!eglMakeCurrent(m_display, m_surface, m_surface, m_context))
+	{
+		LILAC_LOG_ERROR("HeadlessContext", "Failed to make the context current, error 0x" << std::hex << eglGetError());
+		return false;
+	}
+
+	LILAC_LOG_INFO("HeadlessContext", "Created " << (isSurfaceless ? "a surfaceless" : "a pbuffer") << " context");
+
+	return true;
+}
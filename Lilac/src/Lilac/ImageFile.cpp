@@ -0,0 +1,71 @@
+#include <Lilac/ImageFile.h>
+#include <Lilac/Log.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+
+bool Lilac::writePpm(const std::filesystem::path& path, glm::ivec2 size, const uint8_t* rgba)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file << "P6\n" << size.x << " " << size.y << "\n255\n";
+
+	std::vector<uint8_t> row(size_t(size.x) * 3);
+
+	// PPM starts at the top row
+	for (int y = size.y - 1; y >= 0; y--)
+	{
+		const uint8_t* source = rgba + size_t(y) * size.x * 4;
+
+		for (int x = 0; x < size.x; x++)
+		{
+			row[3 * x] = source[4 * x];
+			row[3 * x + 1] = source[4 * x + 1];
+			row[3 * x + 2] = source[4 * x + 2];
+		}
+
+		file.write(reinterpret_cast<const char*>(row.data()), std::streamsize(row.size()));
+	}
+
+	if (!file)
+	{
+		LILAC_LOG_WARNING("ImageFile", "Failed to write " << path);
+		return false;
+	}
+
+	return true;
+}
+
+bool Lilac::writePfm(const std::filesystem::path& path, glm::ivec2 size, const float* rgba)
+{
+	// A negative scale marks the floats as little endian, which every platform this runs on is
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file << "PF\n" << size.x << " " << size.y << "\n-1.0\n";
+
+	std::vector<float> row(size_t(size.x) * 3);
+
+	for (int y = 0; y < size.y; y++)
+	{
+		const float* source = rgba + size_t(y) * size.x * 4;
+
+		for (int x = 0; x < size.x; x++)
+		{
+			row[3 * x] = source[4 * x];
+			row[3 * x + 1] = source[4 * x + 1];
+			row[3 * x + 2] = source[4 * x + 2];
+		}
+
+		file.write(reinterpret_cast<const char*>(row.data()), std::streamsize(row.size() * sizeof(float)));
+	}
+
+	if (!file)
+	{
+		LILAC_LOG_WARNING("ImageFile", "Failed to write " << path);
+		return false;
+	}
+
+	return true;
+}
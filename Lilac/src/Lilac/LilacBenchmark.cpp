@@ -0,0 +1,609 @@
+#include <Lilac/SparseVoxelOctree.h>
+#include <Lilac/Log.h>
+
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace Lilac;
+
+// Live and peak heap bytes of the whole process, counted by the operator new replacements at the bottom of this file
+std::atomic<size_t> heapBytes{ 0 };
+std::atomic<size_t> heapPeakBytes{ 0 };
+
+const int measureRepeats = 3; // Timings are the fastest of this many runs
+const int cameraRayResolution = 512;
+const size_t pointQueryCount = 1 << 20;
+const float distanceTolerance = 1e-4f; // Relative to the distance, hits further than 1 unit away
+const float edgeTolerance = 1e-3f; // World units from a voxel boundary that still count as on it
+
+struct Scene
+{
+	std::string name;
+	std::vector<SparseVoxelOctree::Voxel> voxels;
+};
+
+// https://www.reedbeta.com/blog/hash-functions-for-gpu-rendering/, same as the compute shader
+// Scenes only use this instead of <random>, so they come out the same with every standard library
+uint32_t hashPcg(uint32_t v)
+{
+	uint32_t state = v * 747796405u + 2891336453u;
+	uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+
+	return (word >> 22u) ^ word;
+}
+
+// Uniform in [0, 1)
+float hashUnit(uint32_t x, uint32_t y, uint32_t z)
+{
+	return float(hashPcg(x + hashPcg(y + hashPcg(z))) >> 8) / float(1 << 24);
+}
+
+// Smoothly interpolated lattice values, in [0, 1)
+float valueNoise(float x, float z, uint32_t seed)
+{
+	float cellX = std::floor(x);
+	float cellZ = std::floor(z);
+	float u = x - cellX;
+	float v = z - cellZ;
+
+	u = u * u * (3.0f - 2.0f * u);
+	v = v * v * (3.0f - 2.0f * v);
+
+	auto lattice = [&](float dx, float dz) {
+		return hashUnit(uint32_t(int32_t(cellX + dx)), uint32_t(int32_t(cellZ + dz)), seed);
+	};
+
+	float bottom = lattice(0.0f, 0.0f) + (lattice(1.0f, 0.0f) - lattice(0.0f, 0.0f)) * u;
+	float top = lattice(0.0f, 1.0f) + (lattice(1.0f, 1.0f) - lattice(0.0f, 1.0f)) * u;
+
+	return bottom + (top - bottom) * v;
+}
+
+// Fractional Brownian motion, octaves of value noise at doubling frequency and halving amplitude, in [0, 1)
+float fbm(float x, float z, int octaves)
+{
+	float sum = 0.0f;
+	float amplitude = 0.5f;
+	float normalization = 0.0f;
+
+	for (int octave = 0; octave < octaves; octave++)
+	{
+		sum += amplitude * valueNoise(x, z, uint32_t(octave));
+		normalization += amplitude;
+		x *= 2.0f;
+		z *= 2.0f;
+		amplitude *= 0.5f;
+	}
+
+	return sum / normalization;
+}
+
+Scene makeSolidCubeScene(uint16_t size)
+{
+	Scene scene{ "solid_cube_" + std::to_string(size), {} };
+
+	for (uint16_t z = 0; z < size; z++)
+	{
+		for (uint16_t y = 0; y < size; y++)
+		{
+			for (uint16_t x = 0; x < size; x++)
+			{
+				scene.voxels.push_back({ x, y, z, 1 });
+			}
+		}
+	}
+
+	return scene;
+}
+
+// Solid columns up to an fBm height field, the material changes with height like rock, dirt and grass
+Scene makeTerrainScene(uint16_t size, uint16_t maxHeight)
+{
+	Scene scene{ "fbm_terrain_" + std::to_string(size), {} };
+
+	for (uint16_t z = 0; z < size; z++)
+	{
+		for (uint16_t x = 0; x < size; x++)
+		{
+			float height = fbm(x / 32.0f, z / 32.0f, 5) * maxHeight;
+
+			for (uint16_t y = 0; y < uint16_t(height) + 1; y++)
+			{
+				uint16_t materialId = y + 1 >= height ? 3 : (y + 4 >= height ? 2 : 1);
+				scene.voxels.push_back({ x, y, z, materialId });
+			}
+		}
+	}
+
+	return scene;
+}
+
+// Independent random voxels, the worst case for collapsing
+Scene makeNoiseScene(uint16_t size, float density)
+{
+	Scene scene{ "random_noise_" + std::to_string(size), {} };
+
+	for (uint16_t z = 0; z < size; z++)
+	{
+		for (uint16_t y = 0; y < size; y++)
+		{
+			for (uint16_t x = 0; x < size; x++)
+			{
+				uint32_t hash = hashPcg(x + hashPcg(y + hashPcg(z + 0x9E3779B9u)));
+
+				if (float(hash >> 8) / float(1 << 24) < density)
+				{
+					scene.voxels.push_back({ x, y, z, uint16_t(1 + hash % 3) });
+				}
+			}
+		}
+	}
+
+	return scene;
+}
+
+// The 4x4x4 block from LilacRaytracer, scaled up by `scale`
+Scene makeTestBlockScene(uint16_t scale)
+{
+	Scene scene{ "test_block_x" + std::to_string(scale), {} };
+
+	for (uint16_t z = 0; z < 4 * scale; z++)
+	{
+		for (uint16_t y = 0; y < 4 * scale; y++)
+		{
+			for (uint16_t x = 0; x < 4 * scale; x++)
+			{
+				scene.voxels.push_back({ uint16_t(x + 4 * scale), uint16_t(y + 4 * scale), uint16_t(z + 4 * scale), 1 });
+			}
+		}
+	}
+
+	return scene;
+}
+
+Scene makeSphereShellScene(uint16_t radius)
+{
+	Scene scene{ "sphere_shell_r" + std::to_string(radius), {} };
+
+	float center = radius + 0.5f;
+
+	for (uint16_t z = 0; z <= 2 * radius; z++)
+	{
+		for (uint16_t y = 0; y <= 2 * radius; y++)
+		{
+			for (uint16_t x = 0; x <= 2 * radius; x++)
+			{
+				glm::vec3 offset = glm::vec3(x, y, z) + 0.5f - center;
+				float distance = std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+
+				if (distance <= radius && distance > radius - 1.5f)
+				{
+					scene.voxels.push_back({ x, y, z, uint16_t(1 + (x + y + z) % 3) });
+				}
+			}
+		}
+	}
+
+	return scene;
+}
+
+// Orthographic grid of rays looking down (-1, -1, -1) like the compute shader camera, covering the whole scene
+std::vector<SparseVoxelOctree::Ray> makeCameraRays(float sceneSize, int resolution)
+{
+	std::vector<SparseVoxelOctree::Ray> rays;
+
+	glm::vec3 forward = glm::normalize(glm::vec3(-1.0f, -1.0f, -1.0f));
+	glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+	glm::vec3 up = glm::cross(right, forward);
+	glm::vec3 center = glm::vec3(sceneSize / 2.0f) - forward * sceneSize * 2.0f;
+
+	for (int y = 0; y < resolution; y++)
+	{
+		for (int x = 0; x < resolution; x++)
+		{
+			float u = ((x + 0.5f) / resolution - 0.5f) * sceneSize * 1.5f;
+			float v = ((y + 0.5f) / resolution - 0.5f) * sceneSize * 1.5f;
+
+			rays.push_back({ center + right * u + up * v, forward });
+		}
+	}
+
+	return rays;
+}
+
+double measureRaysPerSecond(const std::vector<SparseVoxelOctree::Ray>& rays, std::vector<SparseVoxelOctree::Hit>& hits, const std::function<SparseVoxelOctree::Hit(const SparseVoxelOctree::Ray&)>& trace)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < rays.size(); i++)
+	{
+		hits[i] = trace(rays[i]);
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	return rays.size() / elapsed.count();
+}
+
+// Where two or more faces meet either one is a valid hit, and a ray along the edge may or may not hit at all
+bool isOnVoxelEdge(const SparseVoxelOctree::Ray& ray, const SparseVoxelOctree::Hit& hit)
+{
+	if (!hit.isHit)
+	{
+		return false;
+	}
+
+	glm::vec3 position = ray.origin + ray.direction * hit.distance;
+	int boundaryAxes = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		boundaryAxes += std::abs(position[axis] - std::round(position[axis])) < edgeTolerance;
+	}
+
+	return boundaryAxes >= 2;
+}
+
+// Hits that disagree, edgeMismatches counts the ones on voxel edges that are left out of the result
+size_t countMismatches(
+	const std::vector<SparseVoxelOctree::Ray>& rays,
+	const std::vector<SparseVoxelOctree::Hit>& expected,
+	const std::vector<SparseVoxelOctree::Hit>& actual,
+	size_t& edgeMismatches)
+{
+	size_t mismatches = 0;
+
+	for (size_t i = 0; i < expected.size(); i++)
+	{
+		bool isSame = expected[i].isHit == actual[i].isHit &&
+			(!expected[i].isHit || (
+				std::abs(expected[i].distance - actual[i].distance) <= distanceTolerance * std::max(1.0f, expected[i].distance) &&
+				expected[i].faceIndex == actual[i].faceIndex &&
+				expected[i].materialId == actual[i].materialId));
+
+		if (isSame)
+		{
+			continue;
+		}
+
+		if (isOnVoxelEdge(rays[i], expected[i]) || isOnVoxelEdge(rays[i], actual[i]))
+		{
+			edgeMismatches++;
+		}
+		else
+		{
+			mismatches++;
+		}
+	}
+
+	return mismatches;
+}
+
+// Fastest of measureRepeats runs
+double measureMilliseconds(const std::function<void()>& run)
+{
+	double fastest = std::numeric_limits<double>::infinity();
+
+	for (int i = 0; i < measureRepeats; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		run();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+		fastest = std::min(fastest, elapsed.count());
+	}
+
+	return fastest;
+}
+
+// Every value of a scene, written as one JSON object
+struct SceneResult
+{
+	std::string name;
+	size_t voxelCount = 0;
+	float sceneSize = 0.0f;
+
+	double buildMilliseconds = 0.0;
+	size_t buildPeakBytes = 0; // Heap high water mark while building, above what was live before
+	size_t treeBytes = 0; // Heap still held by the octree once built
+
+	double flattenMilliseconds = 0.0;
+	size_t flattenedBytes = 0;
+	double flattenFullMilliseconds = 0.0; // With ropes and a 64^3 top grid
+	size_t flattenedFullBytes = 0;
+
+	size_t leafCount = 0;
+	double walkLeavesPerSecond = 0.0;
+
+	double pointQueriesPerSecond = 0.0;
+	size_t pointQuerySolidCount = 0; // Also keeps the queries from being optimized out
+
+	size_t rayCount = 0;
+	double pointerRaysPerSecond = 0.0;
+	double stackRaysPerSecond = 0.0;
+	double ropeRaysPerSecond = 0.0;
+	double topGridRaysPerSecond = 0.0;
+	double batchRaysPerSecond = 0.0; // raycastBatch over every hardware thread
+	size_t rayHitCount = 0;
+	size_t rayMismatches = 0; // Rope or top grid hits that disagree with the stack traversal, any of these fails the run
+	size_t rayEdgeMismatches = 0; // Disagreements on voxel edges, where either answer is right
+};
+
+SceneResult benchmarkScene(const Scene& scene)
+{
+	SceneResult result;
+	result.name = scene.name;
+	result.voxelCount = scene.voxels.size();
+
+	for (const auto& voxel : scene.voxels)
+	{
+		result.sceneSize = std::max({ result.sceneSize, float(voxel.x + 1), float(voxel.y + 1), float(voxel.z + 1) });
+	}
+
+	result.buildMilliseconds = measureMilliseconds([&scene]() {
+		SparseVoxelOctree svo{ { 0.0, 0.0, 0.0 }, scene.voxels };
+	});
+
+	size_t heapBefore = heapBytes;
+	heapPeakBytes = heapBefore;
+
+	auto svo = std::make_unique<SparseVoxelOctree>(glm::vec3(0.0f), scene.voxels);
+
+	result.buildPeakBytes = heapPeakBytes - heapBefore;
+	result.treeBytes = heapBytes - heapBefore;
+
+	std::vector<std::byte> flattened;
+	result.flattenMilliseconds = measureMilliseconds([&]() {
+		flattened = svo->flatten();
+	});
+	result.flattenedBytes = flattened.size();
+
+	result.flattenFullMilliseconds = measureMilliseconds([&]() {
+		flattened = svo->flatten({ .ropes = true, .topGridResolution = 64 });
+	});
+	result.flattenedFullBytes = flattened.size();
+
+	double walkMilliseconds = measureMilliseconds([&]() {
+		result.leafCount = 0;
+		svo->walk([&result](std::vector<size_t>, glm::vec3, uint16_t, uint16_t) {
+			result.leafCount++;
+		});
+	});
+	result.walkLeavesPerSecond = result.leafCount / (walkMilliseconds / 1e3);
+
+	// Spread over the bounds of the scene, hits and misses alike
+	uint16_t queryRange = uint16_t(std::max(1.0f, result.sceneSize));
+	double queryMilliseconds = measureMilliseconds([&]() {
+		result.pointQuerySolidCount = 0;
+
+		for (uint32_t i = 0; i < pointQueryCount; i++)
+		{
+			uint32_t hash = hashPcg(i);
+			uint16_t x = uint16_t(hash % queryRange);
+			uint16_t y = uint16_t(hashPcg(hash) % queryRange);
+			uint16_t z = uint16_t(hashPcg(hash + 1) % queryRange);
+
+			result.pointQuerySolidCount += svo->getMaterialId(x, y, z) != 0;
+		}
+	});
+	result.pointQueriesPerSecond = pointQueryCount / (queryMilliseconds / 1e3);
+
+	auto rays = makeCameraRays(result.sceneSize, cameraRayResolution);
+	std::vector<SparseVoxelOctree::Hit> pointerHits(rays.size());
+	std::vector<SparseVoxelOctree::Hit> stackHits(rays.size());
+	std::vector<SparseVoxelOctree::Hit> ropeHits(rays.size());
+	std::vector<SparseVoxelOctree::Hit> gridHits(rays.size());
+	result.rayCount = rays.size();
+
+	result.pointerRaysPerSecond = measureRaysPerSecond(rays, pointerHits, [&svo](const SparseVoxelOctree::Ray& ray) {
+		return svo->raycast(ray);
+	});
+
+	result.stackRaysPerSecond = measureRaysPerSecond(rays, stackHits, [&flattened](const SparseVoxelOctree::Ray& ray) {
+		return SparseVoxelOctree::raycastFlattened(flattened, ray);
+	});
+
+	result.ropeRaysPerSecond = measureRaysPerSecond(rays, ropeHits, [&flattened](const SparseVoxelOctree::Ray& ray) {
+		return SparseVoxelOctree::raycastFlattenedRopes(flattened, ray);
+	});
+
+	result.topGridRaysPerSecond = measureRaysPerSecond(rays, gridHits, [&flattened](const SparseVoxelOctree::Ray& ray) {
+		return SparseVoxelOctree::raycastFlattenedTopGrid(flattened, ray);
+	});
+
+	double batchMilliseconds = measureMilliseconds([&]() {
+		svo->raycastBatch(rays, pointerHits);
+	});
+	result.batchRaysPerSecond = rays.size() / (batchMilliseconds / 1e3);
+
+	result.rayHitCount = std::count_if(stackHits.begin(), stackHits.end(), [](const SparseVoxelOctree::Hit& hit) {
+		return hit.isHit;
+	});
+	result.rayMismatches = countMismatches(rays, stackHits, ropeHits, result.rayEdgeMismatches) +
+		countMismatches(rays, stackHits, gridHits, result.rayEdgeMismatches);
+
+	return result;
+}
+
+void writeJson(std::ostream& stream, const std::vector<SceneResult>& results)
+{
+	stream << std::fixed << std::setprecision(3);
+	stream << "{\n"
+		<< "  \"benchmark\": \"LilacBenchmark\",\n"
+		<< "  \"schema\": 2,\n"
+		<< "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+		<< "  \"repeats\": " << measureRepeats << ",\n"
+		<< "  \"scenes\": [";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const auto& result = results[i];
+
+		stream << (i == 0 ? "\n" : ",\n") << "    {\n"
+			<< "      \"name\": \"" << result.name << "\",\n"
+			<< "      \"voxels\": " << result.voxelCount << ",\n"
+			<< "      \"build_ms\": " << result.buildMilliseconds << ",\n"
+			<< "      \"build_peak_bytes\": " << result.buildPeakBytes << ",\n"
+			<< "      \"tree_bytes\": " << result.treeBytes << ",\n"
+			<< "      \"flatten_ms\": " << result.flattenMilliseconds << ",\n"
+			<< "      \"flattened_bytes\": " << result.flattenedBytes << ",\n"
+			<< "      \"flatten_full_ms\": " << result.flattenFullMilliseconds << ",\n"
+			<< "      \"flattened_full_bytes\": " << result.flattenedFullBytes << ",\n"
+			<< "      \"leaves\": " << result.leafCount << ",\n"
+			<< "      \"walk_leaves_per_s\": " << result.walkLeavesPerSecond << ",\n"
+			<< "      \"point_queries_per_s\": " << result.pointQueriesPerSecond << ",\n"
+			<< "      \"point_query_solid\": " << result.pointQuerySolidCount << ",\n"
+			<< "      \"rays\": " << result.rayCount << ",\n"
+			<< "      \"ray_hits\": " << result.rayHitCount << ",\n"
+			<< "      \"pointer_rays_per_s\": " << result.pointerRaysPerSecond << ",\n"
+			<< "      \"stack_rays_per_s\": " << result.stackRaysPerSecond << ",\n"
+			<< "      \"rope_rays_per_s\": " << result.ropeRaysPerSecond << ",\n"
+			<< "      \"top_grid_rays_per_s\": " << result.topGridRaysPerSecond << ",\n"
+			<< "      \"batch_rays_per_s\": " << result.batchRaysPerSecond << ",\n"
+			<< "      \"ray_mismatches\": " << result.rayMismatches << ",\n"
+			<< "      \"ray_edge_mismatches\": " << result.rayEdgeMismatches << "\n"
+			<< "    }";
+	}
+
+	stream << "\n  ]\n}\n";
+}
+
+// Builds, flattens, walks, queries and traces a fixed set of synthetic scenes, printing every result as JSON
+// Scenes are deterministic, so results of different builds can be compared, pass a path to write them there instead
+// Ray timings are single threaded except for raycastBatch, the run fails if the traversals disagree away from voxel edges
+int main(int argc, char** argv)
+{
+	std::vector<Scene> scenes;
+	scenes.push_back(makeSolidCubeScene(64));
+	scenes.push_back(makeTestBlockScene(1));
+	scenes.push_back(makeTestBlockScene(16));
+	scenes.push_back(makeSphereShellScene(32));
+	scenes.push_back(makeSphereShellScene(96));
+	scenes.push_back(makeTerrainScene(128, 48));
+	scenes.push_back(makeNoiseScene(64, 0.1f));
+
+	std::vector<SceneResult> results;
+
+	for (const auto& scene : scenes)
+	{
+		LILAC_LOG_INFO("Benchmark", "Benchmarking " << scene.name);
+		results.push_back(benchmarkScene(scene));
+
+		if (results.back().rayMismatches > 0)
+		{
+			LILAC_LOG_ERROR("Benchmark", scene.name << ": " << results.back().rayMismatches << " rays disagree with the stack traversal");
+		}
+	}
+
+	bool isMatching = std::all_of(results.begin(), results.end(), [](const SceneResult& result) {
+		return result.rayMismatches == 0;
+	});
+
+	if (argc > 1)
+	{
+		std::ofstream file(argv[1], std::ios::trunc);
+		writeJson(file, results);
+
+		if (!file)
+		{
+			LILAC_LOG_ERROR("Benchmark", "Failed to write " << argv[1]);
+			return EXIT_FAILURE;
+		}
+	}
+	else
+	{
+		writeJson(std::cout, results);
+	}
+
+	return isMatching ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Counting replacements of the global allocation functions, a size header in front of every block
+// The aligned overloads aren't replaced, nothing in the octree needs them
+namespace
+{
+constexpr size_t heapHeaderSize = alignof(std::max_align_t);
+
+void* countedAllocate(size_t size)
+{
+	auto* block = static_cast<std::byte*>(std::malloc(size + heapHeaderSize));
+
+	if (block == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+
+	*reinterpret_cast<size_t*>(block) = size;
+
+	size_t live = heapBytes += size;
+	size_t peak = heapPeakBytes;
+
+	while (live > peak && !heapPeakBytes.compare_exchange_weak(peak, live))
+	{
+	}
+
+	return block + heapHeaderSize;
+}
+
+void countedFree(void* pointer)
+{
+	if (pointer == nullptr)
+	{
+		return;
+	}
+
+	auto* block = static_cast<std::byte*>(pointer) - heapHeaderSize;
+	heapBytes -= *reinterpret_cast<size_t*>(block);
+	std::free(block);
+}
+}
+
+void* operator new(size_t size)
+{
+	return countedAllocate(size);
+}
+
+void* operator new[](size_t size)
+{
+	return countedAllocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	countedFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	countedFree(pointer);
+}
+
+void operator delete(void* pointer, [[maybe_unused]] size_t size) noexcept
+{
+	countedFree(pointer);
+}
+
+void operator delete[](void* pointer, [[maybe_unused]] size_t size) noexcept
+{
+	countedFree(pointer);
+}
@@ -0,0 +1,296 @@
+#include <Lilac/OpenGL.h>
+
+#include <Lilac/HeadlessContext.h>
+#include <Lilac/Shader.h>
+#include <Lilac/Program.h>
+#include <Lilac/ProgramBinaryCache.h>
+#include <Lilac/ShaderCompileQueue.h>
+#include <Lilac/WorkGroupTuner.h>
+#include <Lilac/File.h>
+#include <Lilac/SparseVoxelOctree.h>
+#include <Lilac/SceneFile.h>
+#include <Lilac/SceneUniforms.h>
+#include <Lilac/GpuProfiler.h>
+#include <Lilac/FrameCapture.h>
+#include <Lilac/Trace.h>
+#include <Lilac/Log.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+using namespace Lilac;
+
+namespace
+{
+// Positive integer argument, empty if it isn't one
+std::optional<int> parseCount(const char* text)
+{
+	int value = 0;
+	auto [end, error] = std::from_chars(text, text + std::strlen(text), value);
+
+	if (error != std::errc() || *end != '\0' || value <= 0)
+	{
+		return std::nullopt;
+	}
+
+	return value;
+}
+}
+
+// Renders a scene file for a number of frames without a window, then writes the frame times and the last image
+// Usage: LilacHeadless <scene file> [frames] [width] [height] [output directory]
+// Every frame is a full image dispatch waited on with glFinish, so the times add up to the throughput of the raytracer alone
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		LILAC_LOG_ERROR("Headless", "Usage: LilacHeadless <scene file> [frames] [width] [height] [output directory]");
+		return EXIT_FAILURE;
+	}
+
+	std::filesystem::path scenePath = argv[1];
+	auto frameCount = argc > 2 ? parseCount(argv[2]) : 64;
+	auto width = argc > 3 ? parseCount(argv[3]) : 512;
+	auto height = argc > 4 ? parseCount(argv[4]) : 512;
+	std::filesystem::path outputDirectory = argc > 5 ? argv[5] : ".";
+
+	if (!frameCount || !width || !height)
+	{
+		LILAC_LOG_ERROR("Headless", "Frames, width and height must be positive integers");
+		return EXIT_FAILURE;
+	}
+
+	const glm::ivec2 renderSize(*width, *height);
+	glm::ivec3 workGroupSize(8, 8, 1);
+	const int octreeSharedLevels = 3; // Same settings as LilacRaytracer starts with
+	const GLenum outputFormat = GL_RGBA8;
+
+	HeadlessContext context;
+
+	if (!context.isValid())
+	{
+		return EXIT_FAILURE;
+	}
+
+	// Core profile, GLEW has to load entry points without the extension string
+	glewExperimental = GL_TRUE;
+	GLenum err = glewInit();
+
+	// GLEW built for GLX reports the missing X display after it loaded the core entry points, they're all this needs
+	if (err != GLEW_OK && err != GLEW_ERROR_NO_GLX_DISPLAY)
+	{
+		LILAC_LOG_ERROR("OpenGL", "glewInit failed: " << glewGetErrorString(err));
+		return EXIT_FAILURE;
+	}
+
+	LILAC_LOG_INFO("OpenGL", "Renderer: " << glGetString(GL_RENDERER));
+	LILAC_LOG_INFO("OpenGL", "Version: " << glGetString(GL_VERSION));
+
+	auto scene = SceneFile::load(scenePath);
+
+	if (!scene)
+	{
+		return EXIT_FAILURE;
+	}
+
+	// Tuning is left to the raytracer, a stored result for this device is still used
+	WorkGroupTuner workGroupTuner{ "cache/workgroup_sizes.txt" };
+
+	if (auto tunedWorkGroupSize = workGroupTuner.load())
+	{
+		workGroupSize = glm::ivec3(tunedWorkGroupSize->x, tunedWorkGroupSize->y, 1);
+	}
+
+	// Shader compiles fail outright if the cached levels don't fit
+	GLint maxSharedMemoryBytes = 0;
+	glGetIntegerv(GL_MAX_COMPUTE_SHARED_MEMORY_SIZE, &maxSharedMemoryBytes);
+
+	std::map<std::string, std::string> shaderMacros = {
+		{"WORKGROUP_SIZE_X", std::to_string(workGroupSize.x)},
+		{"WORKGROUP_SIZE_Y", std::to_string(workGroupSize.y)},
+		{"WORKGROUP_SIZE_Z", std::to_string(workGroupSize.z)},
+		{"SUPERSAMPLE_X", "1"},
+		{"SUPERSAMPLE_Y", "1"},
+		{"OUTPUT_FORMAT", "rgba8"},
+		{"PROGRESSIVE", "1"},
+		{"OCTREE_TRAVERSAL", "TRAVERSAL_STACK"},
+		{"OCTREE_SHARED_LEVELS", std::to_string(SparseVoxelOctree::clampSharedLevels(octreeSharedLevels, size_t(maxSharedMemoryBytes)))},
+		{"OCTREE_TOP_GRID", "0"},
+		{"DEBUG_COUNTERS", "0"}
+	};
+
+	ProgramBinaryCache programCache{ "cache/programs" };
+	ShaderCompileQueue compileQueue{ &programCache };
+
+	ComputeShader raytraceShader{ loadFileString("resources/shaders/raytrace.cs.glsl"), shaderMacros };
+	ComputeProgram raytraceProgram{ raytraceShader, compileQueue };
+
+	SparseVoxelOctree svo{ {0.0, 0.0, 0.0}, scene->voxels };
+	std::vector<std::byte> flattened = svo.flatten();
+
+	if (!raytraceProgram.finishBuild())
+	{
+		LILAC_LOG_ERROR("Headless", "Failed to build the raytracer program");
+		return EXIT_FAILURE;
+	}
+
+	GLuint outputTexture = 0;
+	glGenTextures(1, &outputTexture);
+	glBindTexture(GL_TEXTURE_2D, outputTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, outputFormat, renderSize.x, renderSize.y);
+
+	GLuint accumulationTexture = 0;
+	glGenTextures(1, &accumulationTexture);
+	glBindTexture(GL_TEXTURE_2D, accumulationTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, renderSize.x, renderSize.y);
+
+	GLuint octreeBuffer = 0;
+	glGenBuffers(1, &octreeBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, octreeBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, flattened.size(), flattened.data(), GL_STATIC_DRAW);
+
+	// Bound like in the raytracer, neither is read with these macros
+	// As large as the driver reflects it, which counts one entry of the list, padded
+	const size_t tileListBytes = std::max(sizeof(GLuint), raytraceProgram.getStorageBlockDataSize("TileList"));
+	GLuint tileListBuffer = 0;
+	glGenBuffers(1, &tileListBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, tileListBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, tileListBytes, nullptr, GL_STATIC_DRAW);
+
+	const GLuint zeroCounters[2] = { 0, 0 };
+	GLuint counterBuffer = 0;
+	glGenBuffers(1, &counterBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zeroCounters), zeroCounters, GL_STATIC_DRAW);
+
+	SceneUniforms sceneUniforms{ scene->camera, scene->camera.origin, scene->lightColor, renderSize };
+	GLuint sceneUniformBuffer = 0;
+	glGenBuffers(1, &sceneUniformBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, sceneUniformBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(SceneUniforms), &sceneUniforms, GL_STATIC_DRAW);
+
+	raytraceProgram.validateUniformBlock("Scene", 0, sizeof(SceneUniforms));
+	raytraceProgram.validateStorageBlock("Octree", 2, flattened.size());
+	raytraceProgram.validateStorageBlock("TileList", 3, tileListBytes);
+	raytraceProgram.validateStorageBlock("Counters", 4, sizeof(zeroCounters));
+
+	auto frameIndexUniform = raytraceProgram.getUniform("frame_index");
+	auto useTileListUniform = raytraceProgram.getUniform("use_tile_list");
+
+	raytraceProgram.use();
+	raytraceProgram.setUniform(useTileListUniform, GLint(0));
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, sceneUniformBuffer);
+	glBindImageTexture(0, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, outputFormat);
+	glBindImageTexture(1, accumulationTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, octreeBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, tileListBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, counterBuffer);
+
+	// Round up, the shader skips invocations past the edge of the image
+	const glm::ivec2 workGroupCount(
+		(renderSize.x + workGroupSize.x - 1) / workGroupSize.x,
+		(renderSize.y + workGroupSize.y - 1) / workGroupSize.y);
+
+	GpuProfiler profiler;
+	std::vector<float> gpuMilliseconds(*frameCount, 0.0f);
+	std::vector<float> wallMilliseconds(*frameCount, 0.0f);
+
+	for (int frame = 0; frame < *frameCount; frame++)
+	{
+		LILAC_TRACE_SCOPE("frame");
+
+		auto start = std::chrono::steady_clock::now();
+
+		// Accumulates like the progressive raytracer, the last image is the average of every frame
+		raytraceProgram.setUniform(frameIndexUniform, GLuint(frame));
+
+		{
+			GpuProfiler::Scope raytraceScope{ profiler, "raytrace" };
+			raytraceProgram.dispatch(workGroupCount.x, workGroupCount.y);
+		}
+
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		glFinish();
+
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		wallMilliseconds[frame] = elapsed.count();
+
+		// Finished along with the dispatch
+		profiler.collect();
+
+		for (float milliseconds : profiler.getCollected("raytrace"))
+		{
+			gpuMilliseconds[frame] = milliseconds;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(outputDirectory, error);
+
+	{
+		std::ofstream timesFile(outputDirectory / "frame_times.csv", std::ios::trunc);
+		timesFile << "frame,gpu_ms,wall_ms\n" << std::fixed << std::setprecision(3);
+
+		for (int frame = 0; frame < *frameCount; frame++)
+		{
+			timesFile << frame << "," << gpuMilliseconds[frame] << "," << wallMilliseconds[frame] << "\n";
+		}
+
+		if (!timesFile)
+		{
+			LILAC_LOG_ERROR("Headless", "Failed to write " << outputDirectory / "frame_times.csv");
+			return EXIT_FAILURE;
+		}
+	}
+
+	// First frame left out, it includes the driver's lazy setup
+	float totalGpuMilliseconds = 0.0f;
+	float totalWallMilliseconds = 0.0f;
+
+	for (int frame = *frameCount > 1 ? 1 : 0; frame < *frameCount; frame++)
+	{
+		totalGpuMilliseconds += gpuMilliseconds[frame];
+		totalWallMilliseconds += wallMilliseconds[frame];
+	}
+
+	// Throughput goes by wall time, it covers submission, driver overhead and the glFinish wait on top of the GPU time
+	int timedFrameCount = *frameCount > 1 ? *frameCount - 1 : 1;
+	float averageGpuMilliseconds = totalGpuMilliseconds / float(timedFrameCount);
+	float averageWallMilliseconds = totalWallMilliseconds / float(timedFrameCount);
+
+	LILAC_LOG_INFO("Headless", *frameCount << " frames at " << renderSize.x << "x" << renderSize.y
+		<< ", " << averageWallMilliseconds << " ms per frame, " << averageGpuMilliseconds << " ms of it on the GPU, "
+		<< float(renderSize.x) * float(renderSize.y) / (averageWallMilliseconds * 1e3f) << " Mrays/s");
+
+	profiler.writeFile(outputDirectory / "gpu_profile.txt");
+
+	FrameCapture frameCapture;
+	frameCapture.capture(outputTexture, renderSize, FrameCapture::Format::Ppm, outputDirectory / "frame.ppm");
+	frameCapture.finish();
+
+	LILAC_TRACE_WRITE((outputDirectory / "trace.json").string());
+
+	if (frameCapture.getFailedCount() > 0)
+	{
+		LILAC_LOG_ERROR("Headless", "Failed to write " << outputDirectory / "frame.ppm");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
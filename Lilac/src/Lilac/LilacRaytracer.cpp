@@ -5,8 +5,22 @@
 
 #include <Lilac/Shader.h>
 #include <Lilac/Program.h>
+#include <Lilac/ProgramBinaryCache.h>
+#include <Lilac/ShaderCompileQueue.h>
+#include <Lilac/ComputeVariantCache.h>
+#include <Lilac/WorkGroupTuner.h>
 #include <Lilac/File.h>
 #include <Lilac/SparseVoxelOctree.h>
+#include <Lilac/FrameScheduler.h>
+#include <Lilac/Camera.h>
+#include <Lilac/SceneUniforms.h>
+#include <Lilac/TileMask.h>
+#include <Lilac/GpuProfiler.h>
+#include <Lilac/FrameCapture.h>
+#include <Lilac/UploadRing.h>
+#include <Lilac/Trace.h>
+#include <Lilac/Log.h>
+#include <Lilac/ResolutionController.h>
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
@@ -16,7 +30,8 @@
 
 #include <iostream>
 #include <cstddef>
-#include <fstream>
+#include <iomanip>
+#include <optional>
 #include <sstream>
 #include <vector>
 
@@ -46,17 +61,15 @@ bool initOpenGl()
 	
 	if (err != GLEW_OK)
 	{
-		std::cerr << "Error: " << glewGetErrorString(err) << std::endl;
+		LILAC_LOG_ERROR("OpenGL", "glewInit failed: " << glewGetErrorString(err));
 		return false;
 	}
 
-	std::cout << "" << std::endl;
-	std::cout << "" << "OpenGL Vendor: " << glGetString(GL_VENDOR) << std::endl;
-	std::cout << "" << "OpenGL Renderer: " << glGetString(GL_RENDERER) << std::endl;
-	std::cout << "" << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
-	std::cout << "" << "OpenGL Shading Language Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
-	std::cout << "" << std::endl;
-	std::cout << "Status: Using GLEW " << glewGetString(GLEW_VERSION) << std::endl << std::endl;
+	LILAC_LOG_INFO("OpenGL", "Vendor: " << glGetString(GL_VENDOR));
+	LILAC_LOG_INFO("OpenGL", "Renderer: " << glGetString(GL_RENDERER));
+	LILAC_LOG_INFO("OpenGL", "Version: " << glGetString(GL_VERSION));
+	LILAC_LOG_INFO("OpenGL", "Shading Language Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION));
+	LILAC_LOG_INFO("OpenGL", "Using GLEW " << glewGetString(GLEW_VERSION));
 
 	int work_group_count[3] = { 0, 0, 0 };
 
@@ -64,10 +77,10 @@ bool initOpenGl()
 	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 1, &work_group_count[1]);
 	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 2, &work_group_count[2]);
 
-	std::cout << "Max work group count <" <<
+	LILAC_LOG_INFO("OpenGL", "Max work group count <" <<
 		work_group_count[0] << ", " <<
 		work_group_count[1] << ", " <<
-		work_group_count[2] << ">" << std::endl;
+		work_group_count[2] << ">");
 
 	int work_group_size[3] = { 0, 0, 0 };
 
@@ -75,27 +88,36 @@ bool initOpenGl()
 	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 1, &work_group_size[1]);
 	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 2, &work_group_size[2]);
 
-	std::cout << "Max work group size <" <<
+	LILAC_LOG_INFO("OpenGL", "Max work group size <" <<
 		work_group_size[0] << ", " <<
 		work_group_size[1] << ", " <<
-		work_group_size[2] << ">" << std::endl;
+		work_group_size[2] << ">");
 
 	int work_group_invocations;
 
 	glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &work_group_invocations);
 
-	std::cout << "Max work group invocations: " << work_group_invocations << std::endl;
+	LILAC_LOG_INFO("OpenGL", "Max work group invocations: " << work_group_invocations);
 
 	return true;
 }
 
-// Next step: moving camera!
-// Then, more boxes!
+// Next step: more boxes!
 int main()
 {
 	int windowWidth = 512, windowHeight = 512;
-	int raytracerWidth = 512, raytracerHeight = 512;
-	glm::ivec3 workGroupSize(1, 1, 1); // z should always be 1, unless the compute shader is changed
+	int raytracerWidth = 512, raytracerHeight = 512; // Largest render resolution, the images are allocated at this size
+	glm::ivec3 workGroupSize(8, 8, 1); // Pixel tile per workgroup, z should always be 1, unless the compute shader is changed
+	const bool useWorkGroupTuning = true; // Replace the size above by the fastest one on this device, benchmarked on the first start
+	glm::ivec2 supersampleCount(1, 1); // Rays per pixel along each axis, traced in a loop by each invocation
+	const bool isHdrOutput = false; // rgba16f instead of rgba8 output
+	const GLenum outputFormat = isHdrOutput ? GL_RGBA16F : GL_RGBA8;
+	const bool isProgressive = true; // Accumulate jittered samples across frames until the scene changes
+	const unsigned int maxAccumulatedFrames = 256; // Progressive frames before the image counts as converged and rendering stops
+	const float targetFrameRate = 60.0f;
+	const bool useDynamicResolution = true; // Lower the render resolution when a full image dispatch goes over budget
+	const float targetFrameMilliseconds = 16.6f; // GPU time budget of a full image dispatch
+	const float minResolutionScale = 0.25f;
 	
 
 	sf3d::Window window(sf3d::VideoMode(windowWidth, windowHeight), "OpenGL");
@@ -115,55 +137,72 @@ int main()
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexStorage2D(GL_TEXTURE_2D, 1, outputFormat, raytracerWidth, raytracerHeight);
+
+	GLuint accumulationTexture = 0;
+	glGenTextures(1, &accumulationTexture);
+	glBindTexture(GL_TEXTURE_2D, accumulationTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, raytracerWidth, raytracerHeight);
+
+	const bool useRopeTraversal = false; // Stackless octree traversal, needs ropes in the flattened octree, R toggles it at runtime
+	const int octreeSharedLevels = 3; // Top octree levels each workgroup caches in shared memory, 0 to disable
+	const uint32_t topGridResolution = 0; // Dense grid in front of the octree for large full worlds, e.g. 64, 0 to disable
+	const bool useDirtyTiles = true; // After voxel edits under a still camera, only trace the tiles the edited voxels cover
+	const float maxDirtyTileFraction = 0.5f; // Above this part of the image a full dispatch is cheaper than the tile list
+	const bool useDebugCounters = false; // Count octree traversal steps per ray, C toggles it at runtime
+	const unsigned int debugCounterInterval = 64; // Dispatches between printing and clearing the counters
+	const unsigned int profileReportInterval = 256; // Presented frames between printing the GPU pass times, 0 to only write them on exit
+	const size_t uploadFrameBytes = 4 << 20; // Staging memory per frame in flight for octree, tile list and camera uploads, larger ones stall instead
+	const unsigned int captureInterval = 0; // Dispatches between captures of the output image into captures/, e.g. for video, 0 to only capture on F12
+
+	// Delete the results file to tune again, e.g. after changing the compute shader
+	WorkGroupTuner workGroupTuner{ "cache/workgroup_sizes.txt" };
+	auto tunedWorkGroupSize = useWorkGroupTuning ? workGroupTuner.load() : std::nullopt;
+
+	if (tunedWorkGroupSize)
+	{
+		workGroupSize = glm::ivec3(tunedWorkGroupSize->x, tunedWorkGroupSize->y, 1);
+	}
 
-	glm::ivec2 inputAabbSize(5, 5);
+	// Shader compiles fail outright if the cached levels don't fit
+	GLint maxSharedMemoryBytes = 0;
+	glGetIntegerv(GL_MAX_COMPUTE_SHARED_MEMORY_SIZE, &maxSharedMemoryBytes);
 
 	std::map<std::string, std::string> shaderMacros = {
 		{"WORKGROUP_SIZE_X", std::to_string(workGroupSize.x)},
 		{"WORKGROUP_SIZE_Y", std::to_string(workGroupSize.y)},
 		{"WORKGROUP_SIZE_Z", std::to_string(workGroupSize.z)},
-		{"INPUT_AABB_SIZE_X", std::to_string(inputAabbSize.x)},
-		{"INPUT_AABB_SIZE_Y", std::to_string(inputAabbSize.y)},
-		{"IMAGE_SIZE_X", std::to_string(raytracerWidth)},
-		{"IMAGE_SIZE_Y", std::to_string(raytracerHeight)}
+		{"SUPERSAMPLE_X", std::to_string(supersampleCount.x)},
+		{"SUPERSAMPLE_Y", std::to_string(supersampleCount.y)},
+		{"OUTPUT_FORMAT", isHdrOutput ? "rgba16f" : "rgba8"},
+		{"PROGRESSIVE", isProgressive ? "1" : "0"},
+		{"OCTREE_TRAVERSAL", useRopeTraversal ? "TRAVERSAL_ROPES" : "TRAVERSAL_STACK"},
+		{"OCTREE_SHARED_LEVELS", std::to_string(SparseVoxelOctree::clampSharedLevels(octreeSharedLevels, size_t(maxSharedMemoryBytes)))},
+		{"OCTREE_TOP_GRID", topGridResolution > 0 ? "1" : "0"},
+		{"DEBUG_COUNTERS", "0"}
 	};
 
-	auto raytraceShaderSource = loadFileString("resources/shaders/raytrace.cs.glsl");
-	ComputeShader raytraceShader{ raytraceShaderSource, shaderMacros };
-	ComputeProgram raytraceProgram{ raytraceShader };
-
-	GLuint buffer = 0;
-	const int raysPerPixel = workGroupSize.x * workGroupSize.y * workGroupSize.z;
-	const int channelsPerPixel = 4;
-	const int imageSize = raytracerWidth * raytracerHeight;
-	const int bytesPerFloat = 4;
-	const int bufferSize = bytesPerFloat * raysPerPixel * channelsPerPixel * imageSize;
-
-	glGenBuffers(1, &buffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, bufferSize, NULL, GL_DYNAMIC_COPY); // TODO: Look more into `usage` parameter, it's a bit unclear which I should pick here
-
+	// Keyed by the preprocessed sources, macros and driver, editing a shader or changing a setting above just misses
+	ProgramBinaryCache programCache{ "cache/programs" };
 
-	GLuint aabbBuffer = 0;
-	std::vector<glm::vec4> aabbVectors;
+	// Programs only submit their shaders here, the driver compiles them while the scene below loads
+	ShaderCompileQueue compileQueue{ &programCache };
 
-	// TODO: This is way too many boxes for performance to handle on the compute shader side, need octtree stuff asap
-	// TODO: calculate max boxes in 128MB, can easily use packing to store parent index information
-	for (int x = 0; x < inputAabbSize.x; x++)
-	{
-		for (int z = 0; z < inputAabbSize.y; z++)
-		{
-			glm::vec4 min(x * 0.35, 0.5, z * 0.35, 0.0);
-			glm::vec4 max = min + glm::vec4(0.25);
-
-			aabbVectors.push_back(min);
-			aabbVectors.push_back(max);
-		}
-	}
+	// Features switched at runtime, each combination is its own program with the unused branches compiled out
+	ComputeVariantCache raytraceVariants{ loadFileString("resources/shaders/raytrace.cs.glsl"), shaderMacros, compileQueue };
+	ComputeVariantCache::Features raytraceFeatures = {
+		{"WORKGROUP_SIZE_X", std::to_string(workGroupSize.x)},
+		{"WORKGROUP_SIZE_Y", std::to_string(workGroupSize.y)},
+		{"OCTREE_TRAVERSAL", useRopeTraversal ? "TRAVERSAL_ROPES" : "TRAVERSAL_STACK"},
+		{"DEBUG_COUNTERS", useDebugCounters ? "1" : "0"}
+	};
+	raytraceVariants.prepare(raytraceFeatures);
 
-	glGenBuffers(1, &aabbBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, aabbBuffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, 4 * 4 * aabbVectors.size(), aabbVectors.data(), GL_DYNAMIC_COPY); // TODO: Lookup proper usage
+	// The variant in use, the previous one keeps rendering while a newly requested one builds
+	ComputeProgram* raytraceProgram = nullptr;
+	ComputeVariantCache::Features activeRaytraceFeatures;
+	Program::Uniform frameIndexUniform;
+	Program::Uniform useTileListUniform;
 
 
 	GLuint quad_vbo = 0;
@@ -182,7 +221,8 @@ int main()
 
 	VertexShader vertexShader{ vertexShaderSource, shaderMacros };
 	FragmentShader fragmentShader{ fragmentShaderSource, shaderMacros };
-	RenderProgram quadProgram{ vertexShader, fragmentShader };
+	RenderProgram quadProgram{ vertexShader, fragmentShader, compileQueue };
+	Program::Uniform outputSizeUniform;
 
 
 	std::vector<SparseVoxelOctree::Voxel> voxels;
@@ -210,73 +250,145 @@ int main()
 
 	SparseVoxelOctree svo{ {0.0, 0.0, 0.0}, voxels };
 
-	std::cout << "SVO Contents:" << std::endl;
+	// The walk itself isn't free, skip it unless the lines go somewhere
+	if (Log::isEnabled(LogLevel::Debug))
+	{
+		svo.walk([](std::vector<size_t> indices, glm::vec3 min, uint16_t scale, uint16_t materialId) {
+			std::string path;
 
-	svo.walk([](std::vector<size_t> indices, glm::vec3 min, uint16_t scale, uint16_t materialId) {
-		std::cout << "<";
+			for (auto index : indices)
+			{
+				path += std::to_string(index) + ", ";
+			}
+
+			LILAC_LOG_DEBUG("Raytracer", "SVO node <" << path << "> <" << min.x << ", " << min.y << ", " << min.z << ">"
+				<< ", " << scale << ", " << materialId);
+		});
+	}
 
-		for (auto index : indices)
+	// Ropes stay once any variant has needed them, the other traversals skip over them
+	SparseVoxelOctree::FlattenOptions flattenOptions{ .ropes = useRopeTraversal, .topGridResolution = topGridResolution };
+	std::vector<std::byte> flattened = svo.flatten(flattenOptions);
+
+	// Per frame data is written here while the GPU still reads the frames before, then copied into the buffers below
+	UploadRing uploadRing{ uploadFrameBytes };
+
+	// Only the GPU writes to these, through copies from the ring, they're reallocated when the data outgrows them
+	auto reserveBuffer = [](GLuint buffer, size_t& capacity, size_t size) {
+		if (size > capacity)
 		{
-			std::cout << index << ", ";
+			// Room to grow, an octree edit usually adds a few nodes
+			capacity = size + size / 2;
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
 		}
+	};
 
-		std::cout << "> " << "<" << min.x << ", " << min.y << ", " << min.z << ">" 
-			<< ", " << scale << ", " << materialId << std::endl;
-	});
+	GLuint octreeBuffer = 0;
+	size_t octreeBufferCapacity = 0;
+	glGenBuffers(1, &octreeBuffer);
+	reserveBuffer(octreeBuffer, octreeBufferCapacity, flattened.size());
+	uploadRing.upload(octreeBuffer, 0, flattened.data(), flattened.size());
+
+	// Always bound, the shader only reads it with use_tile_list
+	GLuint tileListBuffer = 0;
+	size_t tileListBufferCapacity = 0;
+	glGenBuffers(1, &tileListBuffer);
+	reserveBuffer(tileListBuffer, tileListBufferCapacity, sizeof(GLuint));
+
+	// Rays and traversal steps, only written by the DEBUG_COUNTERS variants
+	const GLuint zeroCounters[2] = { 0, 0 };
+	GLuint counterBuffer = 0;
+	glGenBuffers(1, &counterBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zeroCounters), zeroCounters, GL_DYNAMIC_READ);
+	unsigned int counterDispatches = 0;
+
+	ResolutionController resolution{ glm::ivec2(raytracerWidth, raytracerHeight), targetFrameMilliseconds, minResolutionScale };
+	auto renderedResolutionRevision = resolution.getRevision();
+	glm::ivec2 renderSize = resolution.getSize();
+	GpuProfiler profiler;
+	unsigned int profiledFrames = 0;
+
+	// PFM keeps the range of the hdr output
+	FrameCapture frameCapture;
+	const auto captureFormat = isHdrOutput ? FrameCapture::Format::Pfm : FrameCapture::Format::Ppm;
+	unsigned int captureCount = 0;
+	unsigned int capturedDispatches = 0;
+	bool isCaptureRequested = false;
+
+	Camera camera;
+	const float cameraPanStep = 1.0f; // World units per arrow key press
+	const float cameraZoomStep = 1.25f; // Half size factor per page up/down press
+	const glm::vec3 lightColor(1.0f, 0.0f, 0.0f); // The light sits at the camera origin
+	std::vector<SparseVoxelOctree::Voxel> erasedVoxels; // Restored last in, first out
+
+	GLuint sceneUniformBuffer = 0;
+	glGenBuffers(1, &sceneUniformBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, sceneUniformBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(SceneUniforms), nullptr, GL_DYNAMIC_DRAW);
+	bool isSceneUniformsDirty = true;
+
+	if (useWorkGroupTuning && !tunedWorkGroupSize)
+	{
+		LILAC_TRACE_SCOPE("tune workgroup size");
 
-	std::vector<std::byte> flattened = svo.flatten();
-    auto parent_count = ((GLuint*)flattened.data())[0];
-    auto leaf_count = ((GLuint*)flattened.data())[1];
+		// The benchmark traces the loaded scene at the largest render size
+		SceneUniforms sceneUniforms{ camera, camera.origin, lightColor, renderSize };
 
-	std::cout << "SVO Begin Flattened (as int): " << std::endl;
-    std::cout << "Header" << std::endl;
-	for (int i = 0; i < 8*4; i++)
-	{
-		std::cout << int(flattened[i]) << " ";
+		glBindBuffer(GL_UNIFORM_BUFFER, sceneUniformBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SceneUniforms), &sceneUniforms);
+
+		auto benchmarkDispatch = [&](ComputeProgram& program, glm::ivec2 tileSize) {
+			program.use();
+			glBindBufferBase(GL_UNIFORM_BUFFER, 0, sceneUniformBuffer);
+			glBindImageTexture(0, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, outputFormat);
+			glBindImageTexture(1, accumulationTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, octreeBuffer);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, tileListBuffer);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, counterBuffer);
+
+			program.dispatch((renderSize.x + tileSize.x - 1) / tileSize.x, (renderSize.y + tileSize.y - 1) / tileSize.y);
+		};
+
+		// Nothing is stored unless it was measured, the next start tries again
+		if (auto tunedSize = workGroupTuner.tune(raytraceVariants, raytraceFeatures, benchmarkDispatch))
+		{
+			workGroupTuner.store(*tunedSize);
+
+			workGroupSize = glm::ivec3(tunedSize->x, tunedSize->y, 1);
+			raytraceFeatures["WORKGROUP_SIZE_X"] = std::to_string(workGroupSize.x);
+			raytraceFeatures["WORKGROUP_SIZE_Y"] = std::to_string(workGroupSize.y);
+		}
 	}
 
-    std::cout << std::endl << "Parents" << std::endl;
-    for (int p = 0; p < parent_count; p++)
-    {
-        for (int i = 0; i < 12*4; i++)
-        {
-            std::cout << int(flattened[32 + p*8*4 + i]) << " ";
-        }
-        std::cout << std::endl;
-    }
-
-    std::cout << "Leaves" << std::endl;
-    for (int p = 0; p < leaf_count; p++)
-    {
-        for (int i = 0; i < 4*4; i++)
-        {
-            std::cout << int(flattened[32 + parent_count*12*4 + p*4*4 + i]) << " ";
-        }
-        std::cout << std::endl;
-    }
-	std::cout << "SVO End Flattened" << std::endl;
-
-    std::cout << flattened.size() << " vs " << 32 + parent_count*12*4 + leaf_count*4*4 << std::endl;
-
-	return 0;
-
-	auto sleepTime = sf3d::milliseconds(1000);
+	TileMask tileMask{ renderSize, glm::ivec2(workGroupSize.x, workGroupSize.y) };
+	GLuint tileListCount = 0; // 0 traces the whole image
+	svo.clearDirtyBounds();
+
+	auto renderedRevision = svo.getRevision();
+	uint64_t imageRevision = 0; // Bumped by every octree update that shows up in the image
+	uint64_t cameraRevision = 0; // Bumped by every camera move
+	auto renderedCameraRevision = cameraRevision;
+
+	FrameScheduler scheduler{ sf3d::seconds(1.0f / targetFrameRate), isProgressive ? maxAccumulatedFrames : 1 };
 	
+	bool isProgramsReady = false;
+
 	auto running = true;
 	while (running)
 	{
-		raytraceProgram.use();
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, aabbBuffer);
-		raytraceProgram.dispatch(raytracerWidth, raytracerHeight);
+		LILAC_TRACE_SCOPE("frame");
 
-		// make sure writing to image has finished before read
-		// TODO: Add this into the compute program with a configurable bitset
-		// But research to see if that is bad performance wise, technical details, matters which image we are reading from etc
-		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		bool isSceneCurrent = svo.getRevision() == renderedRevision && cameraRevision == renderedCameraRevision &&
+			raytraceFeatures == activeRaytraceFeatures;
 
+		// Block on events while there's nothing left to render or write, instead of spinning
 		sf3d::Event event;
-		while (window.pollEvent(event))
+		bool isIdle = isProgramsReady && scheduler.isIdle() && isSceneCurrent && frameCapture.getPendingCount() == 0;
+		bool hasEvent = isIdle ? window.waitEvent(event) : window.pollEvent(event);
+
+		while (hasEvent)
 		{
 			if (event.type == sf3d::Event::Closed)
 			{
@@ -285,49 +397,347 @@ int main()
 			else if (event.type == sf3d::Event::Resized)
 			{
 				glViewport(0, 0, event.size.width, event.size.height);
+				scheduler.requestPresent();
+			}
+			else if (event.type == sf3d::Event::KeyPressed)
+			{
+				glm::vec2 pan(0.0f, 0.0f);
+				float zoom = 1.0f;
+
+				switch (event.key.code)
+				{
+				case sf3d::Keyboard::Left: pan.x -= cameraPanStep; break;
+				case sf3d::Keyboard::Right: pan.x += cameraPanStep; break;
+				case sf3d::Keyboard::Up: pan.y += cameraPanStep; break;
+				case sf3d::Keyboard::Down: pan.y -= cameraPanStep; break;
+				case sf3d::Keyboard::PageUp: zoom = 1.0f / cameraZoomStep; break;
+				case sf3d::Keyboard::PageDown: zoom = cameraZoomStep; break;
+				case sf3d::Keyboard::R:
+					raytraceFeatures["OCTREE_TRAVERSAL"] = raytraceFeatures["OCTREE_TRAVERSAL"] == "TRAVERSAL_ROPES" ? "TRAVERSAL_STACK" : "TRAVERSAL_ROPES";
+					break;
+				case sf3d::Keyboard::C:
+					raytraceFeatures["DEBUG_COUNTERS"] = raytraceFeatures["DEBUG_COUNTERS"] == "1" ? "0" : "1";
+					break;
+				case sf3d::Keyboard::E:
+				{
+					// Erases the voxel under the middle of the screen
+					auto hit = svo.raycast({ camera.origin, camera.forward });
+
+					if (hit.isHit)
+					{
+						// Half a voxel into the hit face, nudged along the ray so hits on edges don't round out of the voxel
+						glm::ivec3 position(glm::floor(camera.origin + camera.forward * (hit.distance + 1e-3f) - hit.normal * 0.5f));
+						SparseVoxelOctree::Voxel voxel{ uint16_t(position.x), uint16_t(position.y), uint16_t(position.z), hit.materialId };
+
+						if (svo.getMaterialId(voxel.x, voxel.y, voxel.z) == 0)
+						{
+							break;
+						}
+
+						erasedVoxels.push_back(voxel);
+						voxel.materialId = 0;
+						svo.setVoxels({ voxel });
+					}
+					break;
+				}
+				case sf3d::Keyboard::Q:
+					if (!erasedVoxels.empty())
+					{
+						svo.setVoxels({ erasedVoxels.back() });
+						erasedVoxels.pop_back();
+					}
+					break;
+				case sf3d::Keyboard::F12: isCaptureRequested = true; break;
+				default: break;
+				}
+
+				if (pan != glm::vec2(0.0f, 0.0f) || zoom != 1.0f)
+				{
+					camera.pan(pan);
+					camera.halfSize *= zoom;
+					cameraRevision++;
+				}
+			}
+			else if (event.type == sf3d::Event::GainedFocus)
+			{
+				scheduler.requestPresent();
+			}
+
+			hasEvent = window.pollEvent(event);
+		}
+
+		// Keeps the window responsive while the driver is still compiling
+		compileQueue.poll();
+
+		if (quadProgram.isFailed())
+		{
+			LILAC_LOG_ERROR("Raytracer", "Failed to build the quad program");
+			return EXIT_FAILURE;
+		}
+
+		if (raytraceFeatures != activeRaytraceFeatures && raytraceFeatures["OCTREE_TRAVERSAL"] == "TRAVERSAL_ROPES" && !flattenOptions.ropes)
+		{
+			// Uploaded before the rope variant is ready, the stack variant renders it just the same
+			flattenOptions.ropes = true;
+			flattened = svo.flatten(flattenOptions);
+
+			reserveBuffer(octreeBuffer, octreeBufferCapacity, flattened.size());
+			uploadRing.upload(octreeBuffer, 0, flattened.data(), flattened.size());
+		}
+
+		if (raytraceFeatures != activeRaytraceFeatures)
+		{
+			auto* requestedProgram = raytraceVariants.tryGet(raytraceFeatures);
+
+			if (requestedProgram != nullptr)
+			{
+				raytraceProgram = requestedProgram;
+				activeRaytraceFeatures = raytraceFeatures;
+
+				frameIndexUniform = raytraceProgram->getUniform("frame_index");
+				useTileListUniform = raytraceProgram->getUniform("use_tile_list");
+
+				// Against the buffers as they are first uploaded, the octree and tile list are resized later on
+				raytraceProgram->validateUniformBlock("Scene", 0, sizeof(SceneUniforms));
+				raytraceProgram->validateStorageBlock("Octree", 2, flattened.size());
+				raytraceProgram->validateStorageBlock("TileList", 3, sizeof(GLuint));
+				raytraceProgram->validateStorageBlock("Counters", 4, sizeof(zeroCounters));
+
+				// Variants can trace differently, don't blend them into the same accumulation
+				tileMask.clear();
+				tileListCount = 0;
+				scheduler.restart();
+			}
+			else if (raytraceVariants.isFailed(raytraceFeatures))
+			{
+				if (raytraceProgram == nullptr)
+				{
+					LILAC_LOG_ERROR("Raytracer", "Failed to build the raytracer program");
+					return EXIT_FAILURE;
+				}
+
+				LILAC_LOG_WARNING("Raytracer", "Failed to build the requested raytracer variant, keeping the current one");
+				raytraceFeatures = activeRaytraceFeatures;
 			}
 		}
 
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		if (!isProgramsReady && raytraceProgram != nullptr && quadProgram.isReady())
+		{
+			outputSizeUniform = quadProgram.getUniform("output_size");
+			isProgramsReady = true;
+		}
 
-		quadProgram.use();
-		glBindVertexArray(quad_vao);
-		glBindTexture(GL_TEXTURE0, outputTexture);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
-		// draw points 0-3 from the currently bound VAO with current in-use shader
-		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		profiler.collect();
 
-		window.display();
-		sf3d::sleep(sleepTime);
+		// Only full image dispatches go into the trace pass, tile lists say nothing about the cost of a frame
+		for (float frameMilliseconds : profiler.getCollected("trace"))
+		{
+			if (useDynamicResolution)
+			{
+				resolution.addFrameTime(frameMilliseconds);
+			}
+		}
 
-		/*std::vector<float> bufferVector(bufferSize);
-		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bufferSize, bufferVector.data());
+		if (resolution.getRevision() != renderedResolutionRevision)
+		{
+			// Only the size the shaders are told about changes, the images stay allocated at the largest size
+			renderSize = resolution.getSize();
+			tileMask = TileMask{ renderSize, glm::ivec2(workGroupSize.x, workGroupSize.y) };
+			tileListCount = 0;
+			scheduler.restart();
+			isSceneUniformsDirty = true;
+			renderedResolutionRevision = resolution.getRevision();
+		}
 
-		std::ofstream bufferFile;
-		bufferFile.open("buffer.csv");
+		if (cameraRevision != renderedCameraRevision)
+		{
+			// Every pixel changes
+			tileMask.clear();
+			tileListCount = 0;
+			isSceneUniformsDirty = true;
+			renderedCameraRevision = cameraRevision;
+		}
 
-		for (int y = 0; y < raytracerHeight; y++)
+		if (svo.getRevision() != renderedRevision)
 		{
-			for (int x = 0; x < raytracerWidth; x++)
+			LILAC_TRACE_SCOPE("octree update");
+
+			// The rest of the image can only be kept if it is finished, or is itself the untouched part of an earlier edit
+			bool canTraceTiles = useDirtyTiles && svo.hasDirtyBounds() && (scheduler.isConverged() || tileListCount > 0);
+			bool isVisible = true;
+
+			if (canTraceTiles)
 			{
-				bufferFile << "<";
-				for (int i = 0; i < channelsPerPixel; i++)
+				// Converged tiles of earlier edits are done, only ones that haven't restart along with the new ones
+				if (scheduler.isConverged())
 				{
-					auto f = bufferVector[y * raytracerWidth * 4 + x * 4 + i]; 
+					tileMask.clear();
+					tileListCount = 0;
+				}
 
-					bufferFile << f;
+				isVisible = tileMask.markBounds(camera, svo.getDirtyBounds()) > 0;
+				canTraceTiles = tileMask.getMarkedCount() <= maxDirtyTileFraction * tileMask.getTileCount();
+			}
 
-					if (i != 3)
-					{
-						bufferFile << " ";
-					}
+			if (!isVisible)
+			{
+				// Entirely off screen, the image and its accumulation stay as they are
+			}
+			else if (canTraceTiles)
+			{
+				auto tiles = tileMask.getMarkedTiles();
+				tileListCount = GLuint(tiles.size());
+
+				if (tileListCount > 0)
+				{
+					reserveBuffer(tileListBuffer, tileListBufferCapacity, tiles.size() * sizeof(GLuint));
+					uploadRing.upload(tileListBuffer, 0, tiles.data(), tiles.size() * sizeof(GLuint));
 				}
-				bufferFile << ">, ";
 			}
-			bufferFile << std::endl;
+			else
+			{
+				tileMask.clear();
+				tileListCount = 0;
+			}
+
+			svo.clearDirtyBounds();
+
+			flattened = svo.flatten(flattenOptions);
+
+			reserveBuffer(octreeBuffer, octreeBufferCapacity, flattened.size());
+			uploadRing.upload(octreeBuffer, 0, flattened.data(), flattened.size());
+
+			renderedRevision = svo.getRevision();
+			imageRevision += isVisible;
+		}
+
+		scheduler.update(imageRevision, cameraRevision);
+
+		if (isProgramsReady && scheduler.shouldDispatch())
+		{
+			LILAC_TRACE_SCOPE("dispatch");
+
+			raytraceProgram->use();
+			if (isSceneUniformsDirty)
+			{
+				// The only per frame upload for camera motion and resolution changes, no shader recompile
+				SceneUniforms sceneUniforms{ camera, camera.origin, lightColor, renderSize };
+
+				uploadRing.upload(sceneUniformBuffer, 0, &sceneUniforms, sizeof(SceneUniforms));
+				isSceneUniformsDirty = false;
+			}
+
+			raytraceProgram->setUniform(frameIndexUniform, GLuint(scheduler.getAccumulatedFrames()));
+			raytraceProgram->setUniform(useTileListUniform, GLint(tileListCount > 0));
+			glBindBufferBase(GL_UNIFORM_BUFFER, 0, sceneUniformBuffer);
+			glBindImageTexture(0, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, outputFormat);
+			glBindImageTexture(1, accumulationTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, octreeBuffer);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, tileListBuffer);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, counterBuffer);
+
+			// Tile list dispatches are their own pass, they'd drag the full image statistics down
+			const std::string tracePass = tileListCount > 0 ? "trace tiles" : "trace";
+			profiler.begin(tracePass);
+
+			if (tileListCount > 0)
+			{
+				raytraceProgram->dispatch(tileListCount);
+			}
+			else
+			{
+				// Round up, the shader skips invocations past the edge of the image
+				const glm::ivec2 workGroupCount(
+					(renderSize.x + workGroupSize.x - 1) / workGroupSize.x,
+					(renderSize.y + workGroupSize.y - 1) / workGroupSize.y);
+
+				raytraceProgram->dispatch(workGroupCount.x, workGroupCount.y);
+			}
+
+			profiler.end(tracePass);
+
+			scheduler.onDispatched();
+
+			if (captureInterval > 0 && ++capturedDispatches >= captureInterval)
+			{
+				isCaptureRequested = true;
+				capturedDispatches = 0;
+			}
+
+			// make sure writing to image has finished before read
+			// TODO: Add this into the compute program with a configurable bitset
+			// But research to see if that is bad performance wise, technical details, matters which image we are reading from etc
+			// The next dispatch imageLoads the accumulation image this one wrote, the quad samples the output
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+			if (activeRaytraceFeatures["DEBUG_COUNTERS"] == "1" && ++counterDispatches >= debugCounterInterval)
+			{
+				// Stalls on the dispatches in flight, fine for a debug variant
+				GLuint counters[2] = { 0, 0 };
+				glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+				glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+				glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), counters);
+				glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zeroCounters), zeroCounters);
+
+				LILAC_LOG_INFO("Raytracer", "Traversal steps per ray: " << (counters[0] > 0 ? float(counters[1]) / float(counters[0]) : 0.0f)
+					<< " over " << counters[0] << " rays");
+				counterDispatches = 0;
+			}
 		}
-		bufferFile.close();
 
-		return 0;*/
+		// Everything reading this frame's uploads is submitted
+		uploadRing.endFrame();
+
+		// The last dispatched image, only the copy is queued here, it is written once the GPU gets to it
+		if (isProgramsReady && isCaptureRequested)
+		{
+			std::ostringstream capturePath;
+			capturePath << "captures/frame_" << std::setw(5) << std::setfill('0') << captureCount++
+				<< (captureFormat == FrameCapture::Format::Pfm ? ".pfm" : ".ppm");
+
+			frameCapture.capture(outputTexture, renderSize, captureFormat, capturePath.str());
+			isCaptureRequested = false;
+		}
+
+		frameCapture.poll();
+
+		// Without a dispatch this re-presents the cached output texture
+		if (isProgramsReady && scheduler.shouldPresent())
+		{
+			LILAC_TRACE_SCOPE("present");
+
+			{
+				GpuProfiler::Scope presentScope{ profiler, "present" };
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+				quadProgram.use();
+				quadProgram.setUniform(outputSizeUniform, renderSize);
+				glBindVertexArray(quad_vao);
+				glActiveTexture(GL_TEXTURE0);
+				glBindTexture(GL_TEXTURE_2D, outputTexture);
+				// draw points 0-3 from the currently bound VAO with current in-use shader
+				glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+			}
+
+			window.display();
+			scheduler.onPresented();
+
+			if (profileReportInterval > 0 && ++profiledFrames >= profileReportInterval)
+			{
+				std::ostringstream profile;
+				profiler.print(profile);
+				LILAC_LOG_INFO("GpuProfiler", "Pass times\n" << profile.str());
+				profiledFrames = 0;
+			}
+		}
+
+		scheduler.paceFrame();
 	}
+
+	frameCapture.finish();
+
+	// The last few measurements may still be in flight, they're left out
+	profiler.collect();
+	profiler.writeFile("gpu_profile.txt");
+	LILAC_TRACE_WRITE("trace.json");
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include <Lilac/Log.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+
+std::mutex Lilac::Log::s_mutex;
+const std::chrono::steady_clock::time_point Lilac::Log::s_start = std::chrono::steady_clock::now();
+
+void Lilac::Log::setLevel(LogLevel level)
+{
+	s_level = level;
+}
+
+Lilac::LogLevel Lilac::Log::getLevel()
+{
+	return s_level;
+}
+
+void Lilac::Log::write(LogLevel level, const char* category, const std::string& message)
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - s_start;
+	bool isError = level >= LogLevel::Error;
+
+	std::lock_guard lock(s_mutex);
+
+	if (isError)
+	{
+		// Both end up on stderr, whatever is buffered goes first to keep the order
+		std::clog.flush();
+	}
+
+	auto& stream = isError ? std::cerr : std::clog;
+	stream << std::fixed << std::setprecision(3) << elapsed.count() << std::defaultfloat
+		<< " [" << getLevelName(level) << "] " << category << ": " << message << '\n';
+}
+
+const char* Lilac::Log::getLevelName(LogLevel level)
+{
+	switch (level)
+	{
+	case LogLevel::Trace: return "trace";
+	case LogLevel::Debug: return "debug";
+	case LogLevel::Info: return "info";
+	case LogLevel::Warning: return "warning";
+	case LogLevel::Error: return "error";
+	default: return "off";
+	}
+}
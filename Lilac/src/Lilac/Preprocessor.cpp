@@ -0,0 +1,794 @@
+#include <Lilac/Preprocessor.h>
+
+#include <Lilac/File.h>
+#include <Lilac/Log.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace
+{
+// Integer constant expression of an #if with every macro substituted, any identifier left makes it fail
+class ConditionParser
+{
+public:
+	explicit ConditionParser(std::string_view text)
+		: m_text(text)
+		, m_position(0)
+		, m_isValid(true)
+	{
+	}
+
+	bool parse(long long& value)
+	{
+		value = parseBinary(1);
+		skipSpace();
+
+		return m_isValid && m_position == m_text.size();
+	}
+
+private:
+	// Lowest first, like C
+	static int getPrecedence(std::string_view op)
+	{
+		if (op == "||") return 1;
+		if (op == "&&") return 2;
+		if (op == "|") return 3;
+		if (op == "^") return 4;
+		if (op == "&") return 5;
+		if (op == "==" || op == "!=") return 6;
+		if (op == "<" || op == ">" || op == "<=" || op == ">=") return 7;
+		if (op == "<<" || op == ">>") return 8;
+		if (op == "+" || op == "-") return 9;
+		if (op == "*" || op == "/" || op == "%") return 10;
+		return 0;
+	}
+
+	std::string_view peekOperator() const
+	{
+		auto rest = m_text.substr(m_position);
+
+		for (std::string_view op : { "||", "&&", "==", "!=", "<=", ">=", "<<", ">>" })
+		{
+			if (rest.starts_with(op))
+			{
+				return op;
+			}
+		}
+
+		return rest.substr(0, std::min<size_t>(rest.size(), 1));
+	}
+
+	long long parseBinary(int minPrecedence)
+	{
+		long long left = parseUnary();
+
+		while (m_isValid)
+		{
+			skipSpace();
+			auto op = peekOperator();
+			int precedence = getPrecedence(op);
+
+			if (precedence == 0 || precedence < minPrecedence)
+			{
+				break;
+			}
+
+			m_position += op.size();
+			long long right = parseBinary(precedence + 1);
+
+			if ((op == "/" || op == "%") && right == 0)
+			{
+				m_isValid = false;
+				return 0;
+			}
+
+			if (op == "||") left = left || right;
+			else if (op == "&&") left = left && right;
+			else if (op == "|") left = left | right;
+			else if (op == "^") left = left ^ right;
+			else if (op == "&") left = left & right;
+			else if (op == "==") left = left == right;
+			else if (op == "!=") left = left != right;
+			else if (op == "<") left = left < right;
+			else if (op == ">") left = left > right;
+			else if (op == "<=") left = left <= right;
+			else if (op == ">=") left = left >= right;
+			else if (op == "<<") left = left << right;
+			else if (op == ">>") left = left >> right;
+			else if (op == "+") left = left + right;
+			else if (op == "-") left = left - right;
+			else if (op == "*") left = left * right;
+			else if (op == "/") left = left / right;
+			else left = left % right;
+		}
+
+		return left;
+	}
+
+	long long parseUnary()
+	{
+		skipSpace();
+
+		if (m_position >= m_text.size())
+		{
+			m_isValid = false;
+			return 0;
+		}
+
+		char c = m_text[m_position];
+
+		if (c == '(')
+		{
+			m_position++;
+			long long value = parseBinary(1);
+			skipSpace();
+
+			m_isValid = m_isValid && m_position < m_text.size() && m_text[m_position] == ')';
+			m_position++;
+			return value;
+		}
+		else if (c == '!' || c == '~' || c == '-' || c == '+')
+		{
+			m_position++;
+			long long value = parseUnary();
+
+			return c == '!' ? !value : c == '~' ? ~value : c == '-' ? -value : value;
+		}
+		else if (std::isdigit(static_cast<unsigned char>(c)))
+		{
+			size_t end = m_position;
+
+			while (end < m_text.size() && std::isalnum(static_cast<unsigned char>(m_text[end])))
+			{
+				end++;
+			}
+
+			// Decimal, octal or hex with an optional u suffix
+			std::string number(m_text.substr(m_position, end - m_position));
+
+			if (number.ends_with('u') || number.ends_with('U'))
+			{
+				number.pop_back();
+			}
+
+			char* parsedEnd = nullptr;
+			long long value = std::strtoll(number.c_str(), &parsedEnd, 0);
+
+			m_isValid = m_isValid && parsedEnd == number.c_str() + number.size();
+			m_position = end;
+			return value;
+		}
+
+		m_isValid = false;
+		return 0;
+	}
+
+	void skipSpace()
+	{
+		while (m_position < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_position])))
+		{
+			m_position++;
+		}
+	}
+
+	std::string_view m_text;
+	size_t m_position;
+	bool m_isValid;
+};
+}
+
+Lilac::Preprocessor::Preprocessor(std::map<std::string, std::string> macros, std::vector<std::filesystem::path> includeDirectories, int maxDepth)
+	: m_macros(macros.begin(), macros.end())
+	, m_includeDirectories(std::move(includeDirectories))
+	, m_maxDepth(maxDepth)
+	, m_isInBlockComment(false)
+{
+}
+
+std::string Lilac::Preprocessor::process(std::string_view source)
+{
+	m_onceFiles.clear();
+	m_sourceNames = { "<source>" };
+	m_isInBlockComment = false;
+	m_conditionals.clear();
+	m_compilerMacros.clear();
+
+	std::string output;
+	output.reserve(source.size());
+
+	processSource(source, {}, 0, 0, output);
+
+	if (!m_conditionals.empty())
+	{
+		LILAC_LOG_ERROR("Preprocessor", m_conditionals.size() << " #if without an #endif");
+		output += "\n#error #if without an #endif";
+	}
+
+	return output;
+}
+
+const std::map<std::string, std::string, std::less<>>& Lilac::Preprocessor::getMacros() const
+{
+	return m_macros;
+}
+
+const std::vector<std::string>& Lilac::Preprocessor::getSourceNames() const
+{
+	return m_sourceNames;
+}
+
+// Every input line becomes exactly one output line, so GLSL error line numbers match the file
+void Lilac::Preprocessor::processSource(std::string_view source, const std::filesystem::path& path, int sourceIndex, int depth, std::string& output)
+{
+	size_t start = 0;
+	int lineNumber = 1;
+
+	while (true)
+	{
+		size_t end = std::min(source.find('\n', start), source.size());
+		auto line = source.substr(start, end - start);
+		auto trimmed = trim(line);
+
+		bool isDirective = !m_isInBlockComment && trimmed.starts_with('#');
+		bool isHandled = isDirective && processConditional(trimmed, depth, output);
+
+		// Branches not taken leave an empty line
+		if (!isHandled && isActive())
+		{
+			isHandled = isDirective && processDirective(trimmed, path, sourceIndex, lineNumber, depth, output);
+
+			if (!isHandled)
+			{
+				substitute(line, depth, output);
+			}
+		}
+
+		if (end == source.size())
+		{
+			break;
+		}
+
+		output += '\n';
+		start = end + 1;
+		lineNumber++;
+	}
+}
+
+bool Lilac::Preprocessor::processDirective(std::string_view line, const std::filesystem::path& path, int sourceIndex, int lineNumber, int depth, std::string& output)
+{
+	auto rest = trim(line.substr(1));
+	auto directive = readIdentifier(rest);
+	auto argument = trim(rest.substr(directive.size()));
+
+	if ((directive == "define" || directive == "undef") && !m_conditionals.empty() && !m_conditionals.back().isEvaluated)
+	{
+		// Only the GLSL compiler knows whether this branch is taken
+		auto name = readIdentifier(argument);
+
+		if (m_macros.find(name) != m_macros.end())
+		{
+			LILAC_LOG_WARNING("Preprocessor", "#" << directive << " " << name << " is in a conditional left to the GLSL compiler, "
+				"the rest of the source keeps the value given before it");
+		}
+
+		m_compilerMacros.insert(std::string(name));
+		output += line;
+		return true;
+	}
+	else if (directive == "define")
+	{
+		auto name = readIdentifier(argument);
+		auto value = argument.substr(name.size());
+
+		// Function like macros are left to the GLSL preprocessor
+		if (name.empty() || value.starts_with('('))
+		{
+			m_compilerMacros.insert(std::string(name));
+			return false;
+		}
+
+		value = trim(value.substr(0, value.find("//")));
+		m_macros.insert_or_assign(std::string(name), std::string(value));
+		return true;
+	}
+	else if (directive == "undef")
+	{
+		auto name = readIdentifier(argument);
+		auto found = m_macros.find(name);
+
+		if (found != m_macros.end())
+		{
+			m_macros.erase(found);
+		}
+
+		auto foundCompiler = m_compilerMacros.find(name);
+
+		if (foundCompiler != m_compilerMacros.end())
+		{
+			m_compilerMacros.erase(foundCompiler);
+			output += line;
+		}
+
+		return true;
+	}
+	else if (directive == "include")
+	{
+		processInclude(argument, path, sourceIndex, lineNumber, depth, output);
+		return true;
+	}
+	else if (directive == "pragma" && readIdentifier(argument) == "once")
+	{
+		if (!path.empty())
+		{
+			m_onceFiles.insert(std::filesystem::weakly_canonical(path));
+		}
+
+		return true;
+	}
+	else if (directive == "version" || directive == "extension")
+	{
+		output += line;
+		return true;
+	}
+
+	return false;
+}
+
+bool Lilac::Preprocessor::processConditional(std::string_view line, int depth, std::string& output)
+{
+	auto rest = trim(line.substr(1));
+	auto directive = readIdentifier(rest);
+	auto argument = trim(rest.substr(directive.size()));
+	argument = trim(argument.substr(0, argument.find("//")));
+
+	if (directive == "if" || directive == "ifdef" || directive == "ifndef")
+	{
+		Conditional conditional;
+		conditional.isParentActive = isActive();
+
+		// Everything inside one left to the GLSL compiler is left to it as well
+		bool isParentEvaluated = m_conditionals.empty() || m_conditionals.back().isEvaluated;
+
+		std::string condition(argument);
+
+		if (directive != "if")
+		{
+			condition = (directive == "ifdef" ? "defined " : "!defined ") + condition;
+		}
+
+		long long value = 0;
+
+		if (!conditional.isParentActive)
+		{
+			// Skipped along with its parent branch
+		}
+		else if (isParentEvaluated && evaluate(condition, depth, value))
+		{
+			conditional.isActive = value != 0;
+			conditional.isTaken = conditional.isActive;
+		}
+		else
+		{
+			conditional.isEvaluated = false;
+			conditional.isActive = true;
+			passCondition("if", condition, depth, output);
+		}
+
+		m_conditionals.push_back(conditional);
+		return true;
+	}
+	else if (directive == "elif" || directive == "else")
+	{
+		// Stray ones are left for the GLSL compiler to report
+		if (m_conditionals.empty())
+		{
+			return false;
+		}
+
+		auto& conditional = m_conditionals.back();
+		long long value = 0;
+
+		if (!conditional.isParentActive)
+		{
+			return true;
+		}
+
+		if (!conditional.isEvaluated)
+		{
+			if (directive == "else")
+			{
+				output += "#else";
+			}
+			else
+			{
+				passCondition("elif", argument, depth, output);
+			}
+		}
+		else if (conditional.isTaken)
+		{
+			conditional.isActive = false;
+		}
+		else if (directive == "else")
+		{
+			conditional.isActive = true;
+			conditional.isTaken = true;
+		}
+		else if (evaluate(argument, depth, value))
+		{
+			conditional.isActive = value != 0;
+			conditional.isTaken = conditional.isActive;
+		}
+		else
+		{
+			// Every branch before this one is out, so the GLSL compiler can take over from here
+			conditional.isEvaluated = false;
+			conditional.isActive = true;
+			passCondition("if", argument, depth, output);
+		}
+
+		return true;
+	}
+	else if (directive == "endif")
+	{
+		if (m_conditionals.empty())
+		{
+			return false;
+		}
+
+		if (m_conditionals.back().isParentActive && !m_conditionals.back().isEvaluated)
+		{
+			output += "#endif";
+		}
+
+		m_conditionals.pop_back();
+		return true;
+	}
+
+	return false;
+}
+
+void Lilac::Preprocessor::passCondition(std::string_view directive, std::string_view argument, int depth, std::string& output)
+{
+	output += "#";
+	output += directive;
+	output += " ";
+	substitute(replaceDefined(argument), depth, output);
+}
+
+void Lilac::Preprocessor::processInclude(std::string_view argument, const std::filesystem::path& path, int sourceIndex, int lineNumber, int depth, std::string& output)
+{
+	std::string_view name;
+
+	if (argument.size() >= 2 && (argument.front() == '"' || argument.front() == '<'))
+	{
+		char close = argument.front() == '"' ? '"' : '>';
+		auto end = argument.find(close, 1);
+
+		if (end != std::string_view::npos)
+		{
+			name = argument.substr(1, end - 1);
+		}
+	}
+
+	if (name.empty())
+	{
+		LILAC_LOG_ERROR("Preprocessor", "Malformed #include " << argument);
+		output += "#error Malformed #include";
+		return;
+	}
+
+	if (depth >= m_maxDepth)
+	{
+		LILAC_LOG_ERROR("Preprocessor", "#include " << name << " is nested more than " << m_maxDepth << " deep");
+		output += "#error #include nested too deep";
+		return;
+	}
+
+	auto includePath = resolveInclude(name, path.parent_path());
+
+	if (includePath.empty())
+	{
+		LILAC_LOG_ERROR("Preprocessor", "Can't find #include " << name);
+		output += "#error Can't find #include ";
+		output += name;
+		return;
+	}
+
+	if (m_onceFiles.contains(std::filesystem::weakly_canonical(includePath)))
+	{
+		return;
+	}
+
+	auto source = loadFileString(includePath.string());
+
+	if (isIncludeGuarded(source))
+	{
+		return;
+	}
+
+	m_sourceNames.push_back(includePath.string());
+	int includeIndex = int(m_sourceNames.size()) - 1;
+
+	// GLSL #line takes the line number of the next line and a source string number, see getSourceNames
+	output += "#line 1 " + std::to_string(includeIndex) + "\n";
+	processSource(source, includePath, includeIndex, depth + 1, output);
+	output += "\n#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceIndex);
+}
+
+void Lilac::Preprocessor::substitute(std::string_view code, int depth, std::string& output)
+{
+	size_t i = 0;
+
+	while (i < code.size())
+	{
+		if (m_isInBlockComment)
+		{
+			auto end = code.find("*/", i);
+
+			if (end == std::string_view::npos)
+			{
+				output += code.substr(i);
+				return;
+			}
+
+			output += code.substr(i, end + 2 - i);
+			i = end + 2;
+			m_isInBlockComment = false;
+			continue;
+		}
+
+		char c = code[i];
+		char next = i + 1 < code.size() ? code[i + 1] : '\0';
+
+		if (c == '/' && next == '/')
+		{
+			output += code.substr(i);
+			return;
+		}
+		else if (c == '/' && next == '*')
+		{
+			output += "/*";
+			i += 2;
+			m_isInBlockComment = true;
+		}
+		else if (isIdentifierStart(c))
+		{
+			auto identifier = readIdentifier(code.substr(i));
+			expand(identifier, depth, output);
+			i += identifier.size();
+		}
+		else if (std::isdigit(static_cast<unsigned char>(c)))
+		{
+			// Whole number with its suffix, so the u of 1u is never taken for an identifier
+			size_t end = i + 1;
+
+			while (end < code.size() && (isIdentifierChar(code[end]) || code[end] == '.'))
+			{
+				end++;
+			}
+
+			output += code.substr(i, end - i);
+			i = end;
+		}
+		else
+		{
+			output += c;
+			i++;
+		}
+	}
+}
+
+void Lilac::Preprocessor::expand(std::string_view name, int depth, std::string& output)
+{
+	auto found = m_macros.find(name);
+
+	if (found == m_macros.end() || std::find(m_expanding.begin(), m_expanding.end(), name) != m_expanding.end())
+	{
+		output += name;
+		return;
+	}
+
+	if (depth >= m_maxDepth)
+	{
+		LILAC_LOG_ERROR("Preprocessor", "Macro " << name << " expands more than " << m_maxDepth << " deep");
+		output += name;
+		return;
+	}
+
+	bool wasInBlockComment = m_isInBlockComment;
+	m_isInBlockComment = false;
+	m_expanding.push_back(found->first);
+
+	substitute(found->second, depth + 1, output);
+
+	m_expanding.pop_back();
+	m_isInBlockComment = wasInBlockComment;
+}
+
+std::string Lilac::Preprocessor::replaceDefined(std::string_view condition) const
+{
+	std::string replaced;
+	size_t i = 0;
+
+	while (i < condition.size())
+	{
+		auto identifier = readIdentifier(condition.substr(i));
+
+		if (identifier.empty())
+		{
+			replaced += condition[i];
+			i++;
+			continue;
+		}
+
+		size_t next = i + identifier.size();
+
+		if (identifier == "defined")
+		{
+			auto operand = trim(condition.substr(next));
+			bool isParenthesized = operand.starts_with('(');
+			auto name = readIdentifier(isParenthesized ? trim(operand.substr(1)) : operand);
+
+			if (!name.empty() && !isCompilerMacro(name))
+			{
+				size_t nameEnd = condition.find(name, next) + name.size();
+				next = isParenthesized ? condition.find(')', nameEnd) + 1 : nameEnd;
+
+				replaced += m_macros.find(name) != m_macros.end() ? "1" : "0";
+				i = next;
+				continue;
+			}
+		}
+
+		replaced += identifier;
+		i = next;
+	}
+
+	return replaced;
+}
+
+bool Lilac::Preprocessor::evaluate(std::string_view condition, int depth, long long& value)
+{
+	std::string substituted;
+	substitute(replaceDefined(condition), depth, substituted);
+
+	ConditionParser parser{ substituted };
+	return parser.parse(value);
+}
+
+// GL_ names are reserved for the compiler and extensions, __ ones for its builtins like __VERSION__
+bool Lilac::Preprocessor::isCompilerMacro(std::string_view name) const
+{
+	return name.starts_with("GL_") || name.starts_with("__") || m_compilerMacros.find(name) != m_compilerMacros.end();
+}
+
+bool Lilac::Preprocessor::isActive() const
+{
+	return m_conditionals.empty() || (m_conditionals.back().isParentActive && m_conditionals.back().isActive);
+}
+
+// The usual #ifndef GUARD first thing in the file, with GUARD defined by an earlier include
+bool Lilac::Preprocessor::isIncludeGuarded(std::string_view source) const
+{
+	size_t start = 0;
+	bool isInComment = false;
+
+	while (start < source.size())
+	{
+		size_t end = std::min(source.find('\n', start), source.size());
+		auto line = trim(source.substr(start, end - start));
+		start = end + 1;
+
+		if (isInComment)
+		{
+			isInComment = line.find("*/") == std::string_view::npos;
+			continue;
+		}
+
+		if (line.empty() || line.starts_with("//"))
+		{
+			continue;
+		}
+
+		if (line.starts_with("/*"))
+		{
+			isInComment = line.find("*/", 2) == std::string_view::npos;
+			continue;
+		}
+
+		if (!line.starts_with('#'))
+		{
+			return false;
+		}
+
+		auto rest = trim(line.substr(1));
+		auto directive = readIdentifier(rest);
+
+		if (directive != "ifndef")
+		{
+			return false;
+		}
+
+		auto guard = readIdentifier(trim(rest.substr(directive.size())));
+		return m_macros.find(guard) != m_macros.end();
+	}
+
+	return false;
+}
+
+std::filesystem::path Lilac::Preprocessor::resolveInclude(std::string_view name, const std::filesystem::path& directory) const
+{
+	std::vector<std::filesystem::path> candidates;
+
+	if (!directory.empty())
+	{
+		candidates.push_back(directory / name);
+	}
+
+	for (const auto& includeDirectory : m_includeDirectories)
+	{
+		candidates.push_back(includeDirectory / name);
+	}
+
+	for (const auto& candidate : candidates)
+	{
+		std::error_code error;
+
+		if (std::filesystem::is_regular_file(candidate, error))
+		{
+			return candidate;
+		}
+	}
+
+	return {};
+}
+
+std::string_view Lilac::Preprocessor::trim(std::string_view text)
+{
+	auto start = text.find_first_not_of(" \t\r");
+
+	if (start == std::string_view::npos)
+	{
+		return {};
+	}
+
+	auto end = text.find_last_not_of(" \t\r");
+
+	return text.substr(start, end + 1 - start);
+}
+
+std::string_view Lilac::Preprocessor::readIdentifier(std::string_view text)
+{
+	if (text.empty() || !isIdentifierStart(text[0]))
+	{
+		return {};
+	}
+
+	size_t end = 1;
+
+	while (end < text.size() && isIdentifierChar(text[end]))
+	{
+		end++;
+	}
+
+	return text.substr(0, end);
+}
+
+bool Lilac::Preprocessor::isIdentifierStart(char c)
+{
+	return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool Lilac::Preprocessor::isIdentifierChar(char c)
+{
+	return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
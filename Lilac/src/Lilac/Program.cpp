@@ -1,10 +1,29 @@
 #include <Lilac/Program.h>
 #include <Lilac/Shader.h>
+#include <Lilac/ShaderCompileQueue.h>
+#include <Lilac/Log.h>
+#include <Lilac/Trace.h>
 
-#include <iostream>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
 #include <vector>
 
 
+Lilac::Program::Program()
+	: m_handle(0)
+	, m_buildState(BuildState::Compiling)
+	, m_cache(nullptr)
+	, m_cacheKey(0)
+{
+}
+
 GLuint Lilac::Program::getRawHandle() const 
 {
 	return m_handle;
@@ -15,9 +34,218 @@ void Lilac::Program::use() const
 	glUseProgram(m_handle);
 }
 
-void Lilac::Program::linkProgram()
+Lilac::Program::Uniform Lilac::Program::getUniform(const std::string& name) const
+{
+	auto found = m_uniforms.find(name);
+
+	if (found == m_uniforms.end())
+	{
+		return Uniform{};
+	}
+
+	return found->second;
+}
+
+bool Lilac::Program::hasUniformBlock(const std::string& name) const
+{
+	return m_uniformBlocks.contains(name);
+}
+
+bool Lilac::Program::hasStorageBlock(const std::string& name) const
+{
+	return m_storageBlocks.contains(name);
+}
+
+size_t Lilac::Program::getStorageBlockDataSize(const std::string& name) const
+{
+	auto found = m_storageBlocks.find(name);
+	return found == m_storageBlocks.end() ? 0 : size_t(found->second.dataSize);
+}
+
+bool Lilac::Program::validateUniformBlock(const std::string& name, GLuint binding, size_t dataSize) const
+{
+	return validateBlock(m_uniformBlocks, "Uniform block", name, binding, dataSize);
+}
+
+bool Lilac::Program::validateStorageBlock(const std::string& name, GLuint binding, size_t dataSize) const
+{
+	return validateBlock(m_storageBlocks, "Shader storage block", name, binding, dataSize);
+}
+
+void Lilac::Program::setUniform(Uniform uniform, GLint value)
+{
+	glProgramUniform1i(m_handle, uniform.location, value);
+}
+
+void Lilac::Program::setUniform(Uniform uniform, GLuint value)
+{
+	glProgramUniform1ui(m_handle, uniform.location, value);
+}
+
+void Lilac::Program::setUniform(Uniform uniform, GLfloat value)
+{
+	glProgramUniform1f(m_handle, uniform.location, value);
+}
+
+void Lilac::Program::setUniform(Uniform uniform, glm::ivec2 value)
+{
+	glProgramUniform2i(m_handle, uniform.location, value.x, value.y);
+}
+
+void Lilac::Program::setUniform(Uniform uniform, glm::vec2 value)
+{
+	glProgramUniform2f(m_handle, uniform.location, value.x, value.y);
+}
+
+void Lilac::Program::setUniform(Uniform uniform, glm::vec3 value)
+{
+	glProgramUniform3f(m_handle, uniform.location, value.x, value.y, value.z);
+}
+
+void Lilac::Program::setUniform(Uniform uniform, glm::vec4 value)
 {
-	glLinkProgram(m_handle);
+	glProgramUniform4f(m_handle, uniform.location, value.x, value.y, value.z, value.w);
+}
+
+void Lilac::Program::startBuild(std::initializer_list<Shader*> shaders, const ProgramBinaryCache* cache)
+{
+	LILAC_TRACE_SCOPE("Program::startBuild");
+
+	m_handle = glCreateProgram();
+	m_buildShaders.assign(shaders.begin(), shaders.end());
+	m_cache = cache != nullptr && cache->isSupported() ? cache : nullptr;
+
+	if (m_cache != nullptr)
+	{
+		m_cacheKey = m_cache->makeKey(std::vector<const Shader*>(shaders.begin(), shaders.end()));
+
+		if (m_cache->tryLoad(m_handle, m_cacheKey))
+		{
+			LILAC_LOG_INFO("Program", "Loaded program " << m_handle << " from the binary cache");
+			reflect();
+
+			m_buildState = BuildState::Ready;
+			m_buildShaders.clear();
+			return;
+		}
+	}
+
+	// Everything goes to the driver up front, with parallel compile support it works on them all at once
+	for (auto* shader : m_buildShaders)
+	{
+		shader->submitCompile();
+	}
+
+	m_buildState = BuildState::Compiling;
+}
+
+bool Lilac::Program::isReady() const
+{
+	return m_buildState == BuildState::Ready;
+}
+
+bool Lilac::Program::isFailed() const
+{
+	return m_buildState == BuildState::Failed;
+}
+
+bool Lilac::Program::pollBuild()
+{
+	return advanceBuild(false);
+}
+
+bool Lilac::Program::finishBuild()
+{
+	advanceBuild(true);
+	return isReady();
+}
+
+bool Lilac::Program::advanceBuild(bool isBlocking)
+{
+	if (m_buildState == BuildState::Compiling)
+	{
+		for (auto* shader : m_buildShaders)
+		{
+			if (!isBlocking && !shader->isCompileFinished())
+			{
+				return false;
+			}
+		}
+
+		bool isCompiled = true;
+
+		for (auto* shader : m_buildShaders)
+		{
+			isCompiled &= shader->finishCompile();
+		}
+
+		if (!isCompiled)
+		{
+			glDeleteProgram(m_handle);
+			m_buildState = BuildState::Failed;
+			m_buildShaders.clear();
+			return true;
+		}
+
+		for (auto* shader : m_buildShaders)
+		{
+			glAttachShader(m_handle, shader->getRawHandle());
+		}
+
+		if (m_cache != nullptr)
+		{
+			glProgramParameteri(m_handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+
+		LILAC_TRACE_SCOPE("Program::link");
+		glLinkProgram(m_handle);
+		m_buildState = BuildState::Linking;
+	}
+
+	if (m_buildState == BuildState::Linking)
+	{
+		if (!isBlocking && !isLinkFinished())
+		{
+			return false;
+		}
+
+		if (finishLink())
+		{
+			if (m_cache != nullptr)
+			{
+				m_cache->store(m_handle, m_cacheKey);
+			}
+
+			m_buildState = BuildState::Ready;
+		}
+		else
+		{
+			m_buildState = BuildState::Failed;
+		}
+
+		m_buildShaders.clear();
+	}
+
+	return true;
+}
+
+bool Lilac::Program::isLinkFinished() const
+{
+	if (!Shader::isParallelCompileSupported())
+	{
+		return true;
+	}
+
+	GLint isCompletion = GL_FALSE;
+	glGetProgramiv(m_handle, GL_COMPLETION_STATUS_KHR, &isCompletion);
+
+	return isCompletion == GL_TRUE;
+}
+
+bool Lilac::Program::finishLink()
+{
+	LILAC_TRACE_SCOPE("Program::finishLink");
+
 	// check for linking errors and validate program as per normal here
 	GLint isLinked = 0;
 	glGetProgramiv(m_handle, GL_LINK_STATUS, &isLinked);
@@ -31,36 +259,173 @@ void Lilac::Program::linkProgram()
 		glGetProgramInfoLog(m_handle, maxLength, &maxLength, &infoLog[0]);
 		std::string infoString(infoLog.begin(), infoLog.end());
 
-		std::cerr << "Shader link error: " << std::endl << infoString << std::endl;
+		LILAC_LOG_ERROR("Program", "Link error:\n" << infoString);
 
 		// The program is useless now. So delete it.
 		glDeleteProgram(m_handle);
 
 		// Provide the infolog in whatever manner you deem best.
 		// TODO: Error
+		return false;
 	}
+
+	reflect();
+	return true;
 }
 
-Lilac::RenderProgram::RenderProgram(const VertexShader &vs, const FragmentShader &fs)
+void Lilac::Program::reflect()
 {
-	m_handle = glCreateProgram();
+	GLint uniformCount = 0;
+	glGetProgramInterfaceiv(m_handle, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+
+	const GLenum uniformProperties[] = { GL_BLOCK_INDEX, GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE };
+
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		GLint values[4] = { 0, 0, 0, 0 };
+		glGetProgramResourceiv(m_handle, GL_UNIFORM, GLuint(i), 4, uniformProperties, 4, nullptr, values);
+
+		// Members of uniform blocks are set through their buffer
+		if (values[0] != -1)
+		{
+			continue;
+		}
+
+		auto name = getResourceName(GL_UNIFORM, GLuint(i));
+		Uniform uniform{ values[1], GLenum(values[2]), values[3] };
 
-	auto vsHandle = vs.getRawHandle();
-	auto fsHandle = fs.getRawHandle();
+		// Arrays are reported as name[0], make them reachable by the plain name as well
+		if (name.ends_with("[0]"))
+		{
+			m_uniforms[name.substr(0, name.size() - 3)] = uniform;
+		}
+
+		m_uniforms[name] = uniform;
+	}
 
-	glAttachShader(m_handle, vsHandle);
-	glAttachShader(m_handle, fsHandle);
-	linkProgram();
+	reflectBlocks(GL_UNIFORM_BLOCK, m_uniformBlocks);
+	reflectBlocks(GL_SHADER_STORAGE_BLOCK, m_storageBlocks);
 }
 
-Lilac::ComputeProgram::ComputeProgram(const ComputeShader& cs)
+void Lilac::Program::reflectBlocks(GLenum programInterface, std::map<std::string, BufferBlock>& blocks)
 {
-	m_handle = glCreateProgram();
+	GLint blockCount = 0;
+	glGetProgramInterfaceiv(m_handle, programInterface, GL_ACTIVE_RESOURCES, &blockCount);
+
+	const GLenum blockProperties[] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+
+	for (GLint i = 0; i < blockCount; i++)
+	{
+		GLint values[2] = { 0, 0 };
+		glGetProgramResourceiv(m_handle, programInterface, GLuint(i), 2, blockProperties, 2, nullptr, values);
+
+		BufferBlock block{ values[0], values[1], values[1] };
 
-	auto csHandle = cs.getRawHandle();
+		if (programInterface == GL_SHADER_STORAGE_BLOCK)
+		{
+			block.fixedDataSize = getFixedDataSize(GLuint(i), values[1]);
+		}
 
-	glAttachShader(m_handle, csHandle);
-	linkProgram();
+		blocks[getResourceName(programInterface, GLuint(i))] = block;
+	}
+}
+
+GLint Lilac::Program::getFixedDataSize(GLuint storageBlockIndex, GLint dataSize) const
+{
+	const GLenum variableCountProperty = GL_NUM_ACTIVE_VARIABLES;
+	GLint variableCount = 0;
+	glGetProgramResourceiv(m_handle, GL_SHADER_STORAGE_BLOCK, storageBlockIndex, 1, &variableCountProperty, 1, nullptr, &variableCount);
+
+	std::vector<GLint> variables(variableCount);
+	const GLenum variablesProperty = GL_ACTIVE_VARIABLES;
+	glGetProgramResourceiv(m_handle, GL_SHADER_STORAGE_BLOCK, storageBlockIndex, 1, &variablesProperty, variableCount, nullptr, variables.data());
+
+	const GLenum variableProperties[] = { GL_OFFSET, GL_ARRAY_SIZE, GL_TOP_LEVEL_ARRAY_SIZE };
+	GLint fixedDataSize = dataSize;
+
+	for (auto variable : variables)
+	{
+		GLint values[3] = { 0, 1, 1 };
+		glGetProgramResourceiv(m_handle, GL_BUFFER_VARIABLE, GLuint(variable), 3, variableProperties, 3, nullptr, values);
+
+		// The unsized array reports a size of 0, or a top level size of 0 for members of an array of structs
+		// It starts at the first of them
+		if (values[1] == 0 || values[2] == 0)
+		{
+			fixedDataSize = std::min(fixedDataSize, values[0]);
+		}
+	}
+
+	return fixedDataSize;
+}
+
+std::string Lilac::Program::getResourceName(GLenum programInterface, GLuint index) const
+{
+	const GLenum nameLengthProperty = GL_NAME_LENGTH;
+	GLint nameLength = 0;
+	glGetProgramResourceiv(m_handle, programInterface, index, 1, &nameLengthProperty, 1, nullptr, &nameLength);
+
+	// The length includes the NULL character
+	std::vector<GLchar> name(std::max(nameLength, 1));
+	glGetProgramResourceName(m_handle, programInterface, index, GLsizei(name.size()), nullptr, name.data());
+
+	return std::string(name.data());
+}
+
+bool Lilac::Program::validateBlock(
+	const std::map<std::string, BufferBlock>& blocks,
+	const char* kind,
+	const std::string& name,
+	GLuint binding,
+	size_t dataSize)
+{
+	auto found = blocks.find(name);
+
+	if (found == blocks.end())
+	{
+		return true;
+	}
+
+	const auto& block = found->second;
+	bool isValid = true;
+
+	if (block.binding != GLint(binding))
+	{
+		LILAC_LOG_WARNING("Program", kind << " " << name << " is at binding " << block.binding << ", expected " << binding);
+		isValid = false;
+	}
+
+	if (size_t(block.fixedDataSize) > dataSize)
+	{
+		LILAC_LOG_WARNING("Program", kind << " " << name << " needs " << block.fixedDataSize << " bytes, only " << dataSize << " are bound");
+		isValid = false;
+	}
+
+	return isValid;
+}
+
+Lilac::RenderProgram::RenderProgram(VertexShader& vs, FragmentShader& fs, const ProgramBinaryCache* cache)
+{
+	startBuild({ &vs, &fs }, cache);
+	finishBuild();
+}
+
+Lilac::RenderProgram::RenderProgram(VertexShader& vs, FragmentShader& fs, ShaderCompileQueue& queue)
+{
+	startBuild({ &vs, &fs }, queue.getCache());
+	queue.add(*this);
+}
+
+Lilac::ComputeProgram::ComputeProgram(ComputeShader& cs, const ProgramBinaryCache* cache)
+{
+	startBuild({ &cs }, cache);
+	finishBuild();
+}
+
+Lilac::ComputeProgram::ComputeProgram(ComputeShader& cs, ShaderCompileQueue& queue)
+{
+	startBuild({ &cs }, queue.getCache());
+	queue.add(*this);
 }
 
 void Lilac::ComputeProgram::dispatch(unsigned int x, unsigned int y, unsigned int z)
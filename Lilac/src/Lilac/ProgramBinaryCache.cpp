@@ -0,0 +1,172 @@
+#include <Lilac/ProgramBinaryCache.h>
+#include <Lilac/Log.h>
+#include <Lilac/Trace.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+Lilac::ProgramBinaryCache::ProgramBinaryCache(std::filesystem::path directory)
+	: m_directory(std::move(directory))
+	, m_isSupported(false)
+{
+	m_driver = getDriverString();
+
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	m_isSupported = formatCount > 0;
+
+	if (m_isSupported)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_directory, error);
+
+		if (error)
+		{
+			LILAC_LOG_WARNING("ProgramBinaryCache", "Disabled, can't create " << m_directory << ": " << error.message());
+			m_isSupported = false;
+		}
+	}
+}
+
+bool Lilac::ProgramBinaryCache::isSupported() const
+{
+	return m_isSupported;
+}
+
+uint64_t Lilac::ProgramBinaryCache::makeKey(const std::vector<const Shader*>& shaders) const
+{
+	uint64_t hash = s_fnvOffsetBasis;
+	hashString(hash, m_driver);
+
+	for (const auto* shader : shaders)
+	{
+		hashString(hash, shader->getProcessedSource());
+
+		for (const auto& [name, value] : shader->getMacros())
+		{
+			hashString(hash, name);
+			hashString(hash, value);
+		}
+	}
+
+	return hash;
+}
+
+bool Lilac::ProgramBinaryCache::tryLoad(GLuint program, uint64_t key) const
+{
+	LILAC_TRACE_SCOPE("ProgramBinaryCache::tryLoad");
+
+	if (!m_isSupported)
+	{
+		return false;
+	}
+
+	std::ifstream file(getPath(key), std::ios::binary);
+
+	if (!file)
+	{
+		return false;
+	}
+
+	uint32_t magic = 0;
+	GLenum format = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&format), sizeof(format));
+
+	if (!file || magic != s_magic)
+	{
+		return false;
+	}
+
+	std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	if (binary.empty())
+	{
+		return false;
+	}
+
+	glProgramBinary(program, format, binary.data(), GLsizei(binary.size()));
+
+	// Drivers reject binaries from other versions here, the caller compiles from source instead
+	GLint isLinked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+
+	return isLinked == GL_TRUE;
+}
+
+void Lilac::ProgramBinaryCache::store(GLuint program, uint64_t key) const
+{
+	LILAC_TRACE_SCOPE("ProgramBinaryCache::store");
+
+	if (!m_isSupported)
+	{
+		return;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+	if (length <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	// Written to the side and renamed, so a crash never leaves a truncated binary behind
+	auto path = getPath(key);
+	auto temporaryPath = path;
+	temporaryPath += ".tmp";
+
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&s_magic), sizeof(s_magic));
+		file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+		file.write(binary.data(), length);
+
+		if (!file)
+		{
+			LILAC_LOG_WARNING("ProgramBinaryCache", "Failed to write " << temporaryPath);
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+
+	if (error)
+	{
+		LILAC_LOG_WARNING("ProgramBinaryCache", "Failed to write " << path << ": " << error.message());
+	}
+}
+
+void Lilac::ProgramBinaryCache::hashString(uint64_t& hash, const std::string& value)
+{
+	// FNV-1a, the terminating zero keeps "ab" "c" and "a" "bc" apart
+	for (char c : value)
+	{
+		hash ^= uint8_t(c);
+		hash *= s_fnvPrime;
+	}
+
+	hash ^= 0;
+	hash *= s_fnvPrime;
+}
+
+std::filesystem::path Lilac::ProgramBinaryCache::getPath(uint64_t key) const
+{
+	std::stringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+
+	return m_directory / name.str();
+}
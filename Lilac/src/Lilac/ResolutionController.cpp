@@ -0,0 +1,68 @@
+#include <Lilac/ResolutionController.h>
+
+#include <glm/vec2.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+
+Lilac::ResolutionController::ResolutionController(glm::ivec2 maxSize, float targetMilliseconds, float minScale)
+	: m_maxSize(maxSize)
+	, m_targetMilliseconds(targetMilliseconds)
+	, m_minScale(minScale)
+	, m_scale(1.0f)
+	, m_size(maxSize)
+	, m_revision(0)
+	, m_averageMilliseconds(0.0f)
+	, m_frameCount(0)
+{
+}
+
+void Lilac::ResolutionController::addFrameTime(float milliseconds)
+{
+	m_averageMilliseconds = m_frameCount == 0 ? milliseconds : m_averageMilliseconds + s_smoothing * (milliseconds - m_averageMilliseconds);
+	m_frameCount++;
+
+	if (m_frameCount < s_settleFrames || m_averageMilliseconds <= 0.0f)
+	{
+		return;
+	}
+
+	float ratio = m_targetMilliseconds / m_averageMilliseconds;
+
+	if (std::abs(ratio - 1.0f) < s_tolerance)
+	{
+		return;
+	}
+
+	float step = std::clamp(std::sqrt(ratio), 1.0f / s_maxStep, s_maxStep);
+	float scale = std::clamp(m_scale * step, m_minScale, 1.0f);
+
+	glm::ivec2 size(
+		std::max(1, int(std::lround(m_maxSize.x * scale))),
+		std::max(1, int(std::lround(m_maxSize.y * scale))));
+
+	m_scale = scale;
+	m_frameCount = 0;
+
+	if (size != m_size)
+	{
+		m_size = size;
+		m_revision++;
+	}
+}
+
+glm::ivec2 Lilac::ResolutionController::getSize() const
+{
+	return m_size;
+}
+
+float Lilac::ResolutionController::getScale() const
+{
+	return m_scale;
+}
+
+uint64_t Lilac::ResolutionController::getRevision() const
+{
+	return m_revision;
+}
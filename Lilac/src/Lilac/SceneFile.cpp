@@ -0,0 +1,112 @@
+#include <Lilac/SceneFile.h>
+#include <Lilac/Log.h>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+
+
+std::optional<Lilac::SceneFile> Lilac::SceneFile::load(const std::filesystem::path& path)
+{
+	std::ifstream file(path);
+
+	if (!file)
+	{
+		LILAC_LOG_ERROR("SceneFile", "Failed to open " << path);
+		return std::nullopt;
+	}
+
+	SceneFile scene;
+	std::string line;
+	int lineNumber = 0;
+
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream stream(line);
+		std::string statement;
+
+		if (!(stream >> statement))
+		{
+			continue;
+		}
+
+		bool isParsed = false;
+
+		if (statement == "voxel")
+		{
+			SparseVoxelOctree::Voxel voxel{ 0, 0, 0, 0 };
+			isParsed = bool(stream >> voxel.x >> voxel.y >> voxel.z >> voxel.materialId);
+
+			if (isParsed)
+			{
+				scene.voxels.push_back(voxel);
+			}
+		}
+		else if (statement == "box")
+		{
+			uint16_t minX = 0, minY = 0, minZ = 0, maxX = 0, maxY = 0, maxZ = 0, materialId = 0;
+			isParsed = bool(stream >> minX >> minY >> minZ >> maxX >> maxY >> maxZ >> materialId);
+
+			for (uint16_t z = minZ; isParsed && z < maxZ; z++)
+			{
+				for (uint16_t y = minY; y < maxY; y++)
+				{
+					for (uint16_t x = minX; x < maxX; x++)
+					{
+						scene.voxels.push_back({ x, y, z, materialId });
+					}
+				}
+			}
+		}
+		else if (statement == "camera")
+		{
+			isParsed = bool(stream >> scene.camera.origin.x >> scene.camera.origin.y >> scene.camera.origin.z
+				>> scene.camera.forward.x >> scene.camera.forward.y >> scene.camera.forward.z >> scene.camera.halfSize);
+			scene.camera.forward = glm::normalize(scene.camera.forward);
+		}
+		else if (statement == "up")
+		{
+			isParsed = bool(stream >> scene.camera.up.x >> scene.camera.up.y >> scene.camera.up.z);
+			scene.camera.up = glm::normalize(scene.camera.up);
+		}
+		else if (statement == "light")
+		{
+			isParsed = bool(stream >> scene.lightColor.x >> scene.lightColor.y >> scene.lightColor.z);
+		}
+
+		std::string rest;
+
+		if (!isParsed || stream >> rest)
+		{
+			LILAC_LOG_ERROR("SceneFile", path.string() << ":" << lineNumber << ": Can't parse \"" << line << "\"");
+			return std::nullopt;
+		}
+	}
+
+	// The image basis is cross(forward, up), which is nothing when they are parallel
+	auto& camera = scene.camera;
+
+	if (glm::length(glm::cross(camera.forward, camera.up)) < s_minUpSine)
+	{
+		glm::vec3 axis = glm::abs(camera.forward);
+		glm::vec3 up = axis.x <= axis.y && axis.x <= axis.z ? glm::vec3(1.0f, 0.0f, 0.0f) :
+			axis.y <= axis.z ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+
+		camera.up = glm::normalize(up - camera.forward * glm::dot(up, camera.forward));
+		LILAC_LOG_WARNING("SceneFile", path << ": Camera forward is parallel to up, using up "
+			<< camera.up.x << " " << camera.up.y << " " << camera.up.z);
+	}
+
+	LILAC_LOG_INFO("SceneFile", "Loaded " << scene.voxels.size() << " voxels from " << path);
+
+	return scene;
+}
@@ -1,32 +1,108 @@
 #include <Lilac/Shader.h>
 
 #include <Lilac/OpenGL.h>
-
-#include <strutil/strutil.h>
+#include <Lilac/Preprocessor.h>
+#include <Lilac/Log.h>
+#include <Lilac/Trace.h>
 
 #include <string>
 #include <memory>
 #include <vector>
-#include <iostream>
 #include <map>
+#include <utility>
+
+Lilac::Shader::Shader(GLenum type, const std::string& source, std::map<std::string, std::string> macros)
+	: m_handle(0)
+	, m_type(type)
+	, m_macros(std::move(macros))
+	, m_isCompiled(false)
+	, m_isCompileFinished(false)
+{
+	LILAC_TRACE_SCOPE("Shader::preprocess");
+
+	Preprocessor preprocessor{ m_macros, { s_includeDirectory }, s_maxDepth };
+	m_processedSource = preprocessor.process(source);
+	m_sourceNames = preprocessor.getSourceNames();
+}
 
 GLuint Lilac::Shader::getRawHandle() const
 {
 	return m_handle;
 }
 
+bool Lilac::Shader::isCompiled() const
+{
+	return m_isCompiled;
+}
+
+const std::string& Lilac::Shader::getProcessedSource() const
+{
+	return m_processedSource;
+}
+
+const std::map<std::string, std::string>& Lilac::Shader::getMacros() const
+{
+	return m_macros;
+}
+
 // TODO: Add logging, error?
-void Lilac::Shader::compileShader(const std::string& source, const std::map<std::string, std::string>& macros)
+bool Lilac::Shader::compileShader()
 {
-	std::cout << "Processing Shader " << m_handle << ":" << std::endl << source << std::endl;
+	LILAC_TRACE_SCOPE("Shader::compileShader");
+
+	submitCompile();
+	return finishCompile();
+}
+
+void Lilac::Shader::submitCompile()
+{
+	if (m_handle != 0)
+	{
+		return;
+	}
+
+	LILAC_TRACE_SCOPE("Shader::submitCompile");
+
+	m_handle = glCreateShader(m_type);
 
-	auto processed = preprocessShader(source, s_maxDepth, macros);
-	auto c_str = processed.c_str();
+	auto c_str = m_processedSource.c_str();
 
-	std::cout << "Compiling Processed Shader " << m_handle << ":" << std::endl << processed << std::endl;
+	LILAC_LOG_DEBUG("Shader", "Compiling shader " << m_handle);
 
 	glShaderSource(m_handle, 1, &c_str, NULL);
 	glCompileShader(m_handle);
+}
+
+bool Lilac::Shader::isCompileFinished() const
+{
+	if (m_isCompileFinished || !isParallelCompileSupported())
+	{
+		return true;
+	}
+
+	GLint isCompletion = GL_FALSE;
+	glGetShaderiv(m_handle, GL_COMPLETION_STATUS_KHR, &isCompletion);
+
+	return isCompletion == GL_TRUE;
+}
+
+bool Lilac::Shader::isParallelCompileSupported()
+{
+	return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+}
+
+bool Lilac::Shader::finishCompile()
+{
+	if (m_isCompileFinished)
+	{
+		return m_isCompiled;
+	}
+
+	submitCompile();
+	m_isCompileFinished = true;
+
+	// Without parallel shader compile, or if it isn't done yet, this is where the driver blocks
+	LILAC_TRACE_SCOPE("Shader::finishCompile");
 
 	GLint isCompiled = 0;
 	glGetShaderiv(m_handle, GL_COMPILE_STATUS, &isCompiled);
@@ -40,69 +116,30 @@ void Lilac::Shader::compileShader(const std::string& source, const std::map<std:
 		glGetShaderInfoLog(m_handle, maxLength, &maxLength, &errorLog[0]);
 
 		std::string errorString(errorLog.begin(), errorLog.end());
-		std::cerr << "!!!!!!!!!! Shader compilation error: " << std::endl << errorString << std::endl;
+
+		// Errors are reported as source(line), with a source per #include
+		for (size_t i = 0; i < m_sourceNames.size(); i++)
+		{
+			errorString += "\n\t" + std::to_string(i) + ": " + m_sourceNames[i];
+		}
+
+		LILAC_LOG_ERROR("Shader", "Compile error:\n" << errorString);
 
 		// Exit with failure.
 		glDeleteShader(m_handle); // Don't leak the shader.
 
 		// TODO: error
+		return false;
 	}
+
+	m_isCompiled = true;
+	return true;
 }
 
-// TODO: Eventually we'd like this to be its own class, but for now it's so simple that it's here
-// TODO: Error handling
 std::string Lilac::Shader::preprocessShader(const std::string& source, int maxDepth, const std::map<std::string, std::string>& macros)
 {
-	const std::string defineMacro = "#define";
-
-	auto lines = strutil::split(source, "\n");
-	std::map<std::string, std::string> sourceMacros(macros);
-
-	std::string sourceWithoutDefines;
-
-	for (auto const& line : lines)
-	{
-		if (strutil::starts_with(line, defineMacro))
-		{
-			auto nameValue = strutil::split(line, " ", 2);
-
-			std::string name = nameValue[1];
-			std::string value = nameValue[2];
-
-			strutil::trim(name);
-			strutil::trim(value);
-
-			sourceMacros[name] = value;
-		}
-		else
-		{
-			sourceWithoutDefines += (line + "\n");
-		}
-	}
-
-	std::cout << "Found macros: " << std::endl;
-
-	for (auto const& [name, value] : sourceMacros)
-	{
-		std::cout << "\t" << name << "->" << value << std::endl;
-	}
-
-	for (int depth = 0; depth < maxDepth; depth++)
-	{
-		bool isReplaced = false;
-
-		for (auto const& [name, value] : sourceMacros)
-		{
-			isReplaced |= strutil::replace_all(sourceWithoutDefines, name, value);
-		}
-
-		if (!isReplaced)
-		{
-			break;
-		}
-	}
-
-	return sourceWithoutDefines;
+	Preprocessor preprocessor{ macros, { s_includeDirectory }, maxDepth };
+	return preprocessor.process(source);
 }
 
 
@@ -112,9 +149,9 @@ Lilac::ComputeShader::ComputeShader(const std::string& source) : ComputeShader(s
 }
 
 Lilac::ComputeShader::ComputeShader(const std::string& source, std::map<std::string, std::string> macros)
+	: Shader(GL_COMPUTE_SHADER, source, std::move(macros))
 {
-	this->m_handle = glCreateShader(GL_COMPUTE_SHADER);
-	this->compileShader(source, macros);
+
 }
 
 
@@ -124,9 +161,9 @@ Lilac::VertexShader::VertexShader(const std::string& source) : VertexShader(sour
 }
 
 Lilac::VertexShader::VertexShader(const std::string& source, std::map<std::string, std::string> macros)
+	: Shader(GL_VERTEX_SHADER, source, std::move(macros))
 {
-	this->m_handle = glCreateShader(GL_VERTEX_SHADER);
-	this->compileShader(source, macros);
+
 }
 
 
@@ -136,7 +173,7 @@ Lilac::FragmentShader::FragmentShader(const std::string& source) : FragmentShade
 }
 
 Lilac::FragmentShader::FragmentShader(const std::string& source, std::map<std::string, std::string> macros)
+	: Shader(GL_FRAGMENT_SHADER, source, std::move(macros))
 {
-	this->m_handle = glCreateShader(GL_FRAGMENT_SHADER);
-	this->compileShader(source, macros);
+
 }
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include <Lilac/ShaderCompileQueue.h>
+#include <Lilac/Shader.h>
+#include <Lilac/Log.h>
+
+#include <algorithm>
+#include <vector>
+
+
+Lilac::ShaderCompileQueue::ShaderCompileQueue(const ProgramBinaryCache* cache)
+	: m_cache(cache)
+	, m_hasFailed(false)
+{
+	// 0xFFFFFFFF leaves the thread count up to the driver
+	if (GLEW_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+	else if (GLEW_ARB_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+	}
+
+	LILAC_LOG_INFO("ShaderCompileQueue", "Parallel shader compile: " << (isParallel() ? "yes" : "no"));
+}
+
+const Lilac::ProgramBinaryCache* Lilac::ShaderCompileQueue::getCache() const
+{
+	return m_cache;
+}
+
+void Lilac::ShaderCompileQueue::add(Program& program)
+{
+	m_pending.push_back(&program);
+}
+
+bool Lilac::ShaderCompileQueue::poll()
+{
+	std::erase_if(m_pending, [this](Program* program) {
+		if (!program->pollBuild())
+		{
+			return false;
+		}
+
+		m_hasFailed |= program->isFailed();
+		return true;
+	});
+
+	return m_pending.empty();
+}
+
+void Lilac::ShaderCompileQueue::finish()
+{
+	for (auto* program : m_pending)
+	{
+		m_hasFailed |= !program->finishBuild();
+	}
+
+	m_pending.clear();
+}
+
+bool Lilac::ShaderCompileQueue::hasFailed() const
+{
+	return m_hasFailed;
+}
+
+bool Lilac::ShaderCompileQueue::isParallel() const
+{
+	return Shader::isParallelCompileSupported();
+}
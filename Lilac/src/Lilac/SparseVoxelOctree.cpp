@@ -1,9 +1,15 @@
 #include <Lilac/SparseVoxelOctree.h>
+#include <Lilac/ThreadPool.h>
+#include <Lilac/Trace.h>
+#include <Lilac/Log.h>
 
 #include <glm/vec3.hpp>
+#include <glm/common.hpp>
 
+#include <array>
 #include <cstddef>
-#include <iostream>
+#include <cstring>
+#include <cmath>
 #include <algorithm>
 #include <vector>
 #include <map>
@@ -11,8 +17,13 @@
 
 
 Lilac::SparseVoxelOctree::SparseVoxelOctree(glm::vec3 min, const std::vector<Voxel>& voxels)
-	: m_head(nullptr)
+	: m_revision(0)
+	, m_hasDirtyBounds(false)
+	, m_dirtyBounds{ glm::vec3(0.0f), glm::vec3(0.0f) }
+	, m_head(nullptr)
 {
+	LILAC_TRACE_SCOPE("SparseVoxelOctree::build");
+
 	uint16_t scale = 1;
 
 	for (const auto& voxel : voxels)
@@ -32,6 +43,51 @@ Lilac::SparseVoxelOctree::SparseVoxelOctree(glm::vec3 min, const std::vector<Vox
 	addVoxels(voxels);
 }
 
+void Lilac::SparseVoxelOctree::setVoxels(const std::vector<Voxel>& voxels)
+{
+	LILAC_TRACE_SCOPE("SparseVoxelOctree::setVoxels");
+
+	addVoxels(voxels);
+	m_revision++;
+
+	for (const auto& voxel : voxels)
+	{
+		glm::vec3 min = glm::vec3(voxel.x, voxel.y, voxel.z);
+		glm::vec3 max = min + 1.0f;
+
+		if (!m_hasDirtyBounds)
+		{
+			m_dirtyBounds = { min, max };
+			m_hasDirtyBounds = true;
+		}
+		else
+		{
+			m_dirtyBounds.min = glm::min(m_dirtyBounds.min, min);
+			m_dirtyBounds.max = glm::max(m_dirtyBounds.max, max);
+		}
+	}
+}
+
+uint64_t Lilac::SparseVoxelOctree::getRevision() const
+{
+	return m_revision;
+}
+
+bool Lilac::SparseVoxelOctree::hasDirtyBounds() const
+{
+	return m_hasDirtyBounds;
+}
+
+Lilac::SparseVoxelOctree::Bounds Lilac::SparseVoxelOctree::getDirtyBounds() const
+{
+	return m_dirtyBounds;
+}
+
+void Lilac::SparseVoxelOctree::clearDirtyBounds()
+{
+	m_hasDirtyBounds = false;
+}
+
 void Lilac::SparseVoxelOctree::walk(const std::function<void(std::vector<size_t>, glm::vec3, uint16_t, uint16_t)>& func)
 {
 	walk_internal(func, m_head, { });
@@ -39,6 +95,13 @@ void Lilac::SparseVoxelOctree::walk(const std::function<void(std::vector<size_t>
 
 std::vector<std::byte> Lilac::SparseVoxelOctree::flatten() const
 {
+	return flatten(FlattenOptions{});
+}
+
+std::vector<std::byte> Lilac::SparseVoxelOctree::flatten(const FlattenOptions& options) const
+{
+	LILAC_TRACE_SCOPE("SparseVoxelOctree::flatten");
+
 	std::vector<std::byte> flattened;
 	std::map<Node*, size_t> parentToIndex;
 	std::map<Node*, size_t> leafToIndex;
@@ -47,22 +110,452 @@ std::vector<std::byte> Lilac::SparseVoxelOctree::flatten() const
 
 	gatherNodes(m_head, parentToIndex, leafToIndex, parents, leaves);
 
-	flattenedWriteHeader(flattened, parents, leaves);
+	GLuint flags =
+		(options.ropes ? s_flattenedRopes : 0) |
+		(options.topGridResolution > 0 ? s_flattenedTopGrid : 0);
+
+	flattenedWriteHeader(flattened, flags, parents, leaves);
 	flattenedWriteParents(flattened, parentToIndex, leafToIndex, parents);
 	flattenedWriteLeaves(flattened, leaves);
 
+	if (options.ropes)
+	{
+		std::map<Node*, std::array<Node*, 6>> nodeToRopes;
+		gatherRopes(m_head, { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr }, nodeToRopes);
+
+		flattenedWriteRopes(flattened, parentToIndex, leafToIndex, parents, leaves, nodeToRopes);
+	}
+
+	if (options.topGridResolution > 0)
+	{
+		flattenedWriteTopGrid(flattened, options.topGridResolution, parentToIndex, leafToIndex, parents.size());
+	}
+
 	return flattened;
 }
 
+Lilac::SparseVoxelOctree::Hit Lilac::SparseVoxelOctree::raycastFlattened(std::span<const std::byte> flattened, const Ray& ray)
+{
+	Hit hit;
+
+	raycastFlattenedNode(flattened, ray, 0, hit); // The root is always node 0
+
+	return hit;
+}
+
+bool Lilac::SparseVoxelOctree::raycastFlattenedNode(std::span<const std::byte> flattened, const Ray& ray, GLuint root, Hit& hit)
+{
+	glm::vec3 inverseDirection = 1.0f / ray.direction;
+	GLuint octantMask =
+		(ray.direction.x < 0.0f) * 1 +
+		(ray.direction.y < 0.0f) * 2 +
+		(ray.direction.z < 0.0f) * 4;
+	GLuint parentCount = readGLuint(flattened, 0);
+
+	std::array<GLuint, s_traversalStackSize> stack;
+	size_t stackSize = 0;
+	stack[stackSize++] = root;
+
+	while (stackSize > 0)
+	{
+		GLuint node = stack[--stackSize];
+		size_t offset = flattenedNodeOffset(flattened, node);
+		bool isLeaf = node >= parentCount;
+
+		glm::vec3 min = readVec3(flattened, offset);
+		GLuint scaleWord = readGLuint(flattened, offset + 3);
+		float scale = isLeaf ? float(scaleWord >> 16) : float(scaleWord);
+
+		float tNear, tFar;
+		int nearAxis;
+
+		if (!intersectAabb(min, min + glm::vec3(scale), ray.origin, inverseDirection, tNear, tFar, nearAxis) ||
+			tNear > ray.maxDistance)
+		{
+			continue;
+		}
+
+		if (!isLeaf)
+		{
+			// Push back to front so the nearest child is popped first
+			for (GLuint i = 8; i > 0; i--)
+			{
+				stack[stackSize++] = readGLuint(flattened, offset + 4 + ((i - 1) ^ octantMask));
+			}
+
+			continue;
+		}
+
+		uint16_t materialId = scaleWord & 0xFFFF;
+
+		if (materialId != 0)
+		{
+			hit.isHit = true;
+			hit.distance = std::max(tNear, 0.0f);
+
+			if (!ray.anyHit)
+			{
+				hit.faceIndex = 2 * nearAxis + int(ray.direction[nearAxis] > 0.0f);
+				hit.normal = faceIndexToNormal(hit.faceIndex);
+				hit.materialId = materialId;
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Cells are visited in ray order, and a cell's node never reaches into a cell that is further along the ray
+// without also covering the cell it was first entered from, so the first hit in any cell is the closest one.
+Lilac::SparseVoxelOctree::Hit Lilac::SparseVoxelOctree::raycastFlattenedTopGrid(std::span<const std::byte> flattened, const Ray& ray)
+{
+	Hit hit;
+
+	size_t gridOffset = flattenedTopGridOffset(flattened);
+	int resolution = int(readGLuint(flattened, gridOffset));
+	float cellSize = readFloat(flattened, gridOffset + 1);
+	size_t cellsOffset = gridOffset + s_flattenedTopGridHeaderWords;
+
+	glm::vec3 inverseDirection = 1.0f / ray.direction;
+	glm::vec3 gridMin = readVec3(flattened, 4);
+	float gridScale = float(readGLuint(flattened, 2));
+
+	float tNear, tFar;
+	int nearAxis;
+
+	if (!intersectAabb(gridMin, gridMin + glm::vec3(gridScale), ray.origin, inverseDirection, tNear, tFar, nearAxis))
+	{
+		return hit;
+	}
+
+	float t = std::max(tNear, 0.0f);
+	glm::vec3 start = (ray.origin + ray.direction * t - gridMin) / cellSize;
+
+	int cell[3];
+	int cellStep[3];
+	float tNext[3];
+	float tDelta[3];
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		cell[axis] = std::clamp(int(std::floor(start[axis])), 0, resolution - 1);
+
+		if (ray.direction[axis] == 0.0f)
+		{
+			cellStep[axis] = 0;
+			tNext[axis] = std::numeric_limits<float>::infinity();
+			tDelta[axis] = std::numeric_limits<float>::infinity();
+		}
+		else
+		{
+			cellStep[axis] = ray.direction[axis] > 0.0f ? 1 : -1;
+			float plane = gridMin[axis] + (cell[axis] + (cellStep[axis] > 0)) * cellSize;
+			tNext[axis] = (plane - ray.origin[axis]) * inverseDirection[axis];
+			tDelta[axis] = std::abs(cellSize * inverseDirection[axis]);
+		}
+	}
+
+	while (t <= ray.maxDistance)
+	{
+		GLuint node = readGLuint(flattened, cellsOffset + cell[0] + resolution * (cell[1] + resolution * cell[2]));
+
+		if (node != s_flattenedNoNode && raycastFlattenedNode(flattened, ray, node, hit))
+		{
+			break;
+		}
+
+		int axis = tNext[0] < tNext[1]
+			? (tNext[0] < tNext[2] ? 0 : 2)
+			: (tNext[1] < tNext[2] ? 1 : 2);
+
+		t = tNext[axis];
+		cell[axis] += cellStep[axis];
+
+		if (cell[axis] < 0 || cell[axis] >= resolution)
+		{
+			break;
+		}
+
+		tNext[axis] += tDelta[axis];
+	}
+
+	return hit;
+}
+
+// Enter the root, then repeatedly descend to the leaf containing the current point, and leave it through the
+// face the ray exits from. Exit faces always point along the ray so t never goes backwards.
+Lilac::SparseVoxelOctree::Hit Lilac::SparseVoxelOctree::raycastFlattenedRopes(std::span<const std::byte> flattened, const Ray& ray)
+{
+	Hit hit;
+
+	glm::vec3 inverseDirection = 1.0f / ray.direction;
+	GLuint parentCount = readGLuint(flattened, 0);
+	GLuint leafCount = readGLuint(flattened, 1);
+	size_t ropesOffset = s_flattenedHeaderWords + s_flattenedParentWords * parentCount + s_flattenedLeafWords * leafCount;
+
+	glm::vec3 rootMin = readVec3(flattened, 4);
+	float rootScale = float(readGLuint(flattened, 2));
+
+	float tNear, tFar;
+	int nearAxis;
+
+	if (!intersectAabb(rootMin, rootMin + glm::vec3(rootScale), ray.origin, inverseDirection, tNear, tFar, nearAxis))
+	{
+		return hit;
+	}
+
+	float t = std::max(tNear, 0.0f);
+	GLuint node = 0;
+
+	while (t <= ray.maxDistance)
+	{
+		glm::vec3 position = ray.origin + ray.direction * t;
+		size_t offset = flattenedNodeOffset(flattened, node);
+
+		while (node < parentCount)
+		{
+			glm::vec3 center = readVec3(flattened, offset) + readGLuint(flattened, offset + 3) / 2.0f;
+			GLuint childIndex =
+				(position.x >= center.x) * 1 +
+				(position.y >= center.y) * 2 +
+				(position.z >= center.z) * 4;
+
+			node = readGLuint(flattened, offset + 4 + childIndex);
+			offset = flattenedNodeOffset(flattened, node);
+		}
+
+		GLuint scaleWord = readGLuint(flattened, offset + 3);
+		uint16_t materialId = scaleWord & 0xFFFF;
+		glm::vec3 min = readVec3(flattened, offset);
+		glm::vec3 max = min + glm::vec3(float(scaleWord >> 16));
+
+		if (materialId != 0)
+		{
+			hit.isHit = true;
+			hit.distance = t;
+
+			if (!ray.anyHit)
+			{
+				// Only the hit leaf needs its entry face, so it's cheaper to redo the slab test once here
+				intersectAabb(min, max, ray.origin, inverseDirection, tNear, tFar, nearAxis);
+
+				hit.faceIndex = 2 * nearAxis + int(ray.direction[nearAxis] > 0.0f);
+				hit.normal = faceIndexToNormal(hit.faceIndex);
+				hit.materialId = materialId;
+			}
+
+			break;
+		}
+
+		int exitAxis = 0;
+		float tExit = std::numeric_limits<float>::infinity();
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			// Far side of the slab, axes the ray runs parallel to come out as inf
+			float tAxis = std::fmax(
+				(min[axis] - ray.origin[axis]) * inverseDirection[axis],
+				(max[axis] - ray.origin[axis]) * inverseDirection[axis]);
+
+			if (tAxis < tExit)
+			{
+				tExit = tAxis;
+				exitAxis = axis;
+			}
+		}
+
+		int exitFace = 2 * exitAxis + int(ray.direction[exitAxis] < 0.0f);
+		node = readGLuint(flattened, ropesOffset + s_flattenedRopeWords * node + exitFace);
+
+		if (node == s_flattenedNoNode)
+		{
+			break;
+		}
+
+		t = std::max(t, tExit);
+	}
+
+	return hit;
+}
+
+Lilac::SparseVoxelOctree::Hit Lilac::SparseVoxelOctree::raycast(const Ray& ray) const
+{
+	Hit hit;
+
+	glm::vec3 inverseDirection = 1.0f / ray.direction;
+	size_t octantMask =
+		(ray.direction.x < 0.0f) * 1 +
+		(ray.direction.y < 0.0f) * 2 +
+		(ray.direction.z < 0.0f) * 4;
+
+	raycastNode(m_head, ray, inverseDirection, octantMask, hit);
+
+	return hit;
+}
+
+void Lilac::SparseVoxelOctree::raycastBatch(std::span<const Ray> rays, std::span<Hit> hits) const
+{
+	size_t rayCount = std::min(rays.size(), hits.size());
+	auto& pool = ThreadPool::getShared();
+	size_t raysPerThread = std::max(s_minRaysPerThread, (rayCount + pool.getThreadCount() - 1) / pool.getThreadCount());
+
+	// The pool's workers are already running, this only wakes them
+	pool.parallelFor((rayCount + raysPerThread - 1) / raysPerThread, [this, rays, hits, rayCount, raysPerThread](size_t range) {
+		LILAC_TRACE_SCOPE("SparseVoxelOctree::raycastBatch range");
+
+		for (size_t i = range * raysPerThread; i < std::min(rayCount, (range + 1) * raysPerThread); i++)
+		{
+			hits[i] = raycast(rays[i]);
+		}
+	});
+}
+
+uint16_t Lilac::SparseVoxelOctree::getMaterialId(uint16_t x, uint16_t y, uint16_t z) const
+{
+	glm::vec3 offset = glm::vec3(x, y, z) - m_head->min;
+	float scale = float(m_head->scale);
+
+	if (offset.x < 0.0f || offset.y < 0.0f || offset.z < 0.0f || offset.x >= scale || offset.y >= scale || offset.z >= scale)
+	{
+		return 0;
+	}
+
+	const Node* node = m_head;
+
+	while (!node->isLeaf())
+	{
+		node = node->children[globalPositionToChildIndex(node, x, y, z)];
+	}
+
+	return node->materialId;
+}
+
+size_t Lilac::SparseVoxelOctree::getSharedLevelsBytes(int levels)
+{
+	// Parents are stored breadth first, so the top levels are the first (8^levels - 1) / 7 parents at most
+	size_t parentCount = ((size_t(1) << (3 * levels)) - 1) / 7;
+
+	return parentCount * s_flattenedParentWords * sizeof(GLuint);
+}
+
+int Lilac::SparseVoxelOctree::clampSharedLevels(int levels, size_t maxBytes)
+{
+	// 16 levels is the deepest an octree with uint16_t coordinates gets
+	int clamped = std::clamp(levels, 0, 16);
+
+	while (clamped > 0 && getSharedLevelsBytes(clamped) > maxBytes)
+	{
+		clamped--;
+	}
+
+	if (clamped < levels)
+	{
+		LILAC_LOG_WARNING("SparseVoxelOctree", levels << " shared octree levels need " << getSharedLevelsBytes(std::min(levels, 16))
+			<< " bytes of shared memory, the device has " << maxBytes << ", using " << clamped);
+	}
+
+	return clamped;
+}
+
+glm::vec3 Lilac::SparseVoxelOctree::faceIndexToNormal(int faceIndex)
+{
+	glm::vec3 normal(0.0f, 0.0f, 0.0f);
+	normal[faceIndex / 2] = (faceIndex % 2 == 0) ? 1.0f : -1.0f;
+
+	return normal;
+}
+
+// Visiting children as (i ^ octantMask) is front to back along the ray, so the first hit is the closest one
+bool Lilac::SparseVoxelOctree::raycastNode(const Node* node, const Ray& ray, glm::vec3 inverseDirection, size_t octantMask, Hit& hit) const
+{
+	float tNear, tFar;
+	int nearAxis;
+
+	if (!intersectAabb(node->min, node->min + glm::vec3(node->scale), ray.origin, inverseDirection, tNear, tFar, nearAxis) ||
+		tNear > ray.maxDistance)
+	{
+		return false;
+	}
+
+	if (node->isLeaf())
+	{
+		if (node->materialId == 0)
+		{
+			return false;
+		}
+
+		hit.isHit = true;
+		hit.distance = std::max(tNear, 0.0f);
+
+		if (!ray.anyHit)
+		{
+			// Entering through the min side of an axis means we hit the face pointing down that axis
+			hit.faceIndex = 2 * nearAxis + int(ray.direction[nearAxis] > 0.0f);
+			hit.normal = faceIndexToNormal(hit.faceIndex);
+			hit.materialId = node->materialId;
+		}
+
+		return true;
+	}
+
+	for (size_t i = 0; i < 8; i++)
+	{
+		if (raycastNode(node->children[i ^ octantMask], ray, inverseDirection, octantMask, hit))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Same slab test as intersect_aabb in raytrace.cs.glsl, fmin/fmax drop the NaN from 0 * inf
+// see: https://tavianator.com/2022/ray_box_boundary.html
+bool Lilac::SparseVoxelOctree::intersectAabb(
+	glm::vec3 min,
+	glm::vec3 max,
+	glm::vec3 origin,
+	glm::vec3 inverseDirection,
+	float& tNear,
+	float& tFar,
+	int& nearAxis)
+{
+	tNear = -std::numeric_limits<float>::infinity();
+	tFar = std::numeric_limits<float>::infinity();
+	nearAxis = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float tMin = (min[axis] - origin[axis]) * inverseDirection[axis];
+		float tMax = (max[axis] - origin[axis]) * inverseDirection[axis];
+
+		float tAxisNear = std::fmin(tMin, tMax);
+		float tAxisFar = std::fmax(tMin, tMax);
+
+		if (tAxisNear > tNear)
+		{
+			tNear = tAxisNear;
+			nearAxis = axis;
+		}
+
+		tFar = std::fmin(tFar, tAxisFar);
+	}
+
+	return tFar >= tNear && tFar >= 0.0f;
+}
+
 void Lilac::SparseVoxelOctree::flattenedWriteHeader(
 	std::vector<std::byte>& vec, 
+	GLuint flags,
 	const std::vector<Node*>& parents, 
 	const std::vector<Node*>& leaves) const
 {
 	pushGLuint(vec, parents.size());  // parent_count
 	pushGLuint(vec, leaves.size());   // leaf_count
 	pushGLuint(vec, m_head->scale);   // scale16u
-	pushGLuint(vec, 0);               // padding
+	pushGLuint(vec, flags);           // flags
 	pushVec3AsVec4(vec, m_head->min); // min
 }
 
@@ -83,11 +576,7 @@ void Lilac::SparseVoxelOctree::flattenedWriteParents(
 
 		for (Node* child : parent->children)
 		{
-			size_t index = child->isLeaf()
-				? parent_count + leafToIndex.at(child)
-				: parentToIndex.at(child);
-
-			pushGLuint(vec, index);
+			pushGLuint(vec, flattenedNodeIndex(child, parentToIndex, leafToIndex, parent_count));
 		}
 	}
 }
@@ -107,25 +596,219 @@ void Lilac::SparseVoxelOctree::flattenedWriteLeaves(
 	}
 }
 
-void Lilac::SparseVoxelOctree::gatherNodes(Node* current,
+// Ropes of a child either point at a sibling, or refine the parent's rope on that face by one level.
+// The parent's rope is a leaf or a subtree of the parent's size, so its children are the child's size.
+void Lilac::SparseVoxelOctree::gatherRopes(
+	Node* node,
+	const std::array<Node*, 6>& ropes,
+	std::map<Node*, std::array<Node*, 6>>& nodeToRopes)
+{
+	nodeToRopes[node] = ropes;
+
+	if (node->isLeaf())
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < 8; i++)
+	{
+		std::array<Node*, 6> childRopes{};
+
+		for (size_t face = 0; face < 6; face++)
+		{
+			size_t axisBit = size_t(1) << (face / 2);
+			bool isPositiveFace = face % 2 == 0;
+			bool isUpperChild = (i & axisBit) != 0;
+			size_t neighborIndex = i ^ axisBit;
+
+			if (isUpperChild != isPositiveFace)
+			{
+				childRopes[face] = node->children[neighborIndex];
+			}
+			else
+			{
+				Node* rope = ropes[face];
+				childRopes[face] = (rope != nullptr && !rope->isLeaf()) ? rope->children[neighborIndex] : rope;
+			}
+		}
+
+		gatherRopes(node->children[i], childRopes, nodeToRopes);
+	}
+}
+
+void Lilac::SparseVoxelOctree::flattenedWriteRopes(
+	std::vector<std::byte>& vec,
+	const std::map<Node*, size_t>& parentToIndex,
+	const std::map<Node*, size_t>& leafToIndex,
+	const std::vector<Node*>& parents,
+	const std::vector<Node*>& leaves,
+	const std::map<Node*, std::array<Node*, 6>>& nodeToRopes)
+{
+	size_t parent_count = parents.size();
+
+	auto writeNodeRopes = [&](Node* node) {
+		for (Node* rope : nodeToRopes.at(node))
+		{
+			pushGLuint(vec, rope == nullptr
+				? s_flattenedNoNode
+				: flattenedNodeIndex(rope, parentToIndex, leafToIndex, parent_count));
+		}
+
+		pushGLuint(vec, 0); // padding
+		pushGLuint(vec, 0); // padding
+	};
+
+	for (Node* parent : parents)
+	{
+		writeNodeRopes(parent);
+	}
+
+	for (Node* leaf : leaves)
+	{
+		writeNodeRopes(leaf);
+	}
+}
+
+GLuint Lilac::SparseVoxelOctree::flattenedNodeIndex(
+	Node* node,
+	const std::map<Node*, size_t>& parentToIndex,
+	const std::map<Node*, size_t>& leafToIndex,
+	size_t parentCount)
+{
+	return node->isLeaf()
+		? parentCount + leafToIndex.at(node)
+		: parentToIndex.at(node);
+}
+
+void Lilac::SparseVoxelOctree::flattenedWriteTopGrid(
+	std::vector<std::byte>& vec,
+	uint32_t resolution,
+	const std::map<Node*, size_t>& parentToIndex,
+	const std::map<Node*, size_t>& leafToIndex,
+	size_t parentCount) const
+{
+	// Cells must be whole subtrees, so the grid is a power of two no finer than the voxels
+	uint32_t powerOfTwoResolution = 1;
+	while (powerOfTwoResolution * 2 <= std::min<uint32_t>(resolution, m_head->scale))
+	{
+		powerOfTwoResolution *= 2;
+	}
+
+	uint16_t cellScale = m_head->scale / powerOfTwoResolution;
+
+	pushGLuint(vec, powerOfTwoResolution); // resolution
+	pushFloat(vec, cellScale);             // cell_size
+	pushGLuint(vec, 0);                    // padding
+	pushGLuint(vec, 0);                    // padding
+
+	for (uint32_t z = 0; z < powerOfTwoResolution; z++)
+	{
+		for (uint32_t y = 0; y < powerOfTwoResolution; y++)
+		{
+			for (uint32_t x = 0; x < powerOfTwoResolution; x++)
+			{
+				glm::vec3 cellCenter = m_head->min + (glm::vec3(x, y, z) + 0.5f) * float(cellScale);
+				Node* node = m_head;
+
+				while (!node->isLeaf() && node->scale > cellScale)
+				{
+					glm::vec3 halfScale(node->scale / 2.0f);
+					glm::vec3 relative = cellCenter - node->min;
+					size_t childIndex =
+						(relative.x >= halfScale.x) * 1 +
+						(relative.y >= halfScale.y) * 2 +
+						(relative.z >= halfScale.z) * 4;
+
+					node = node->children[childIndex];
+				}
+
+				bool isEmpty = node->isLeaf() && node->materialId == 0;
+
+				pushGLuint(vec, isEmpty
+					? s_flattenedNoNode
+					: flattenedNodeIndex(node, parentToIndex, leafToIndex, parentCount));
+			}
+		}
+	}
+}
+
+size_t Lilac::SparseVoxelOctree::flattenedTopGridOffset(std::span<const std::byte> flattened)
+{
+	GLuint parentCount = readGLuint(flattened, 0);
+	GLuint leafCount = readGLuint(flattened, 1);
+	GLuint flags = readGLuint(flattened, 3);
+
+	size_t offset = s_flattenedHeaderWords + s_flattenedParentWords * parentCount + s_flattenedLeafWords * leafCount;
+
+	if (flags & s_flattenedRopes)
+	{
+		offset += s_flattenedRopeWords * (parentCount + leafCount);
+	}
+
+	return offset;
+}
+
+size_t Lilac::SparseVoxelOctree::flattenedNodeOffset(std::span<const std::byte> flattened, GLuint node)
+{
+	GLuint parentCount = readGLuint(flattened, 0);
+
+	return node < parentCount
+		? s_flattenedHeaderWords + s_flattenedParentWords * node
+		: s_flattenedHeaderWords + s_flattenedParentWords * parentCount + s_flattenedLeafWords * (node - parentCount);
+}
+
+GLuint Lilac::SparseVoxelOctree::readGLuint(std::span<const std::byte> vec, size_t wordIndex)
+{
+	GLuint x;
+	std::memcpy(&x, vec.data() + 4 * wordIndex, 4);
+
+	return x;
+}
+
+GLfloat Lilac::SparseVoxelOctree::readFloat(std::span<const std::byte> vec, size_t wordIndex)
+{
+	GLfloat x;
+	std::memcpy(&x, vec.data() + 4 * wordIndex, 4);
+
+	return x;
+}
+
+glm::vec3 Lilac::SparseVoxelOctree::readVec3(std::span<const std::byte> vec, size_t wordIndex)
+{
+	return {
+		readFloat(vec, wordIndex),
+		readFloat(vec, wordIndex + 1),
+		readFloat(vec, wordIndex + 2)
+	};
+}
+
+// Breadth first, so the top levels of the tree are a prefix of parents (see OCTREE_SHARED_LEVELS in octree.glsl)
+void Lilac::SparseVoxelOctree::gatherNodes(Node* root,
 	std::map<Node*, size_t>& parentToIndex,
 	std::map<Node*, size_t>& leafToIndex,
 	std::vector<Node*>& parents,
 	std::vector<Node*>& leaves) const
 {
-	if (current->isLeaf())
-	{
-		leafToIndex[current] = leaves.size();
-		leaves.push_back(current);
-	}
-	else
+	std::vector<Node*> queue{ root };
+
+	for (size_t i = 0; i < queue.size(); i++)
 	{
-		parentToIndex[current] = parents.size();
-		parents.push_back(current);
+		Node* current = queue[i];
 
-		for (auto child : current->children)
+		if (current->isLeaf())
+		{
+			leafToIndex[current] = leaves.size();
+			leaves.push_back(current);
+		}
+		else
 		{
-			gatherNodes(child, parentToIndex, leafToIndex, parents, leaves);
+			parentToIndex[current] = parents.size();
+			parents.push_back(current);
+
+			for (auto child : current->children)
+			{
+				queue.push_back(child);
+			}
 		}
 	}
 }
@@ -227,6 +910,8 @@ void Lilac::SparseVoxelOctree::addVoxel(Node* parent, size_t leafIndex, Node* no
 
 bool Lilac::SparseVoxelOctree::tryCollapseNodes()
 {
+	LILAC_TRACE_SCOPE("SparseVoxelOctree::tryCollapseNodes");
+
 	return tryCollapseNode(nullptr, 0, m_head);
 }
 
@@ -263,9 +948,9 @@ bool Lilac::SparseVoxelOctree::tryCollapseNode(Node* parent, size_t childIndex,
 
 void Lilac::SparseVoxelOctree::collapseNode(Node* parent, size_t childIndex, Node* node)
 {
-	std::cout << "Collapsing Node: " << "<" << node->min.x << ", " << node->min.y << ", " << node->min.z << ">" <<
-		"Scale: " << node->scale << " " <<
-		"MaterialId: " << node->materialId << std::endl;
+	LILAC_LOG_TRACE("SparseVoxelOctree", "Collapsing node <" << node->min.x << ", " << node->min.y << ", " << node->min.z << ">" <<
+		" Scale: " << node->scale <<
+		" MaterialId: " << node->materialId);
 
 	auto min = node->min;
 	auto scale = node->scale;
@@ -295,7 +980,7 @@ glm::vec3 Lilac::SparseVoxelOctree::octantIndexToOffset(size_t i)
 	};
 }
 
-size_t Lilac::SparseVoxelOctree::globalPositionToChildIndex(Node* node, uint16_t x, uint16_t y, uint16_t z)
+size_t Lilac::SparseVoxelOctree::globalPositionToChildIndex(const Node* node, uint16_t x, uint16_t y, uint16_t z)
 {
 	auto min = node->min;
 	auto halfScale = node->scale / 2.0f;
@@ -0,0 +1,128 @@
+#include <Lilac/ThreadPool.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+Lilac::ThreadPool::ThreadPool(size_t workerCount)
+	: m_task(nullptr)
+	, m_count(0)
+	, m_next(0)
+	, m_activeWorkers(0)
+	, m_generation(0)
+	, m_isStopping(false)
+{
+	for (size_t i = 0; i < workerCount; i++)
+	{
+		m_workers.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+Lilac::ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_isStopping = true;
+	}
+
+	m_wake.notify_all();
+
+	for (auto& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void Lilac::ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	std::lock_guard run(m_runMutex);
+
+	{
+		std::lock_guard lock(m_mutex);
+		m_task = &task;
+		m_count = count;
+		m_next = 0;
+		m_generation++;
+	}
+
+	if (count > 1)
+	{
+		m_wake.notify_all();
+	}
+
+	drain(task, count);
+
+	// Every index is claimed once drain returns, a worker still inside its last one holds the run open
+	std::unique_lock lock(m_mutex);
+	m_done.wait(lock, [this]() { return m_activeWorkers == 0; });
+	m_task = nullptr;
+}
+
+size_t Lilac::ThreadPool::getThreadCount() const
+{
+	return m_workers.size() + 1;
+}
+
+Lilac::ThreadPool& Lilac::ThreadPool::getShared()
+{
+	static ThreadPool pool{ std::max(1u, std::thread::hardware_concurrency()) - 1 };
+	return pool;
+}
+
+void Lilac::ThreadPool::work()
+{
+	uint64_t seenGeneration = 0;
+
+	while (true)
+	{
+		const std::function<void(size_t)>* task = nullptr;
+		size_t count = 0;
+
+		{
+			std::unique_lock lock(m_mutex);
+			m_wake.wait(lock, [this, seenGeneration]() { return m_isStopping || m_generation != seenGeneration; });
+
+			if (m_isStopping)
+			{
+				return;
+			}
+
+			seenGeneration = m_generation;
+
+			// Woken after the run already finished
+			if (m_task == nullptr)
+			{
+				continue;
+			}
+
+			task = m_task;
+			count = m_count;
+			m_activeWorkers++;
+		}
+
+		drain(*task, count);
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_activeWorkers--;
+		}
+
+		m_done.notify_one();
+	}
+}
+
+void Lilac::ThreadPool::drain(const std::function<void(size_t)>& task, size_t count)
+{
+	for (size_t i = m_next++; i < count; i = m_next++)
+	{
+		task(i);
+	}
+}
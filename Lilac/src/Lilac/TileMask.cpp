@@ -0,0 +1,98 @@
+#include <Lilac/TileMask.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+
+Lilac::TileMask::TileMask(glm::ivec2 imageSize, glm::ivec2 tileSize)
+	: m_imageSize(imageSize)
+	, m_tileSize(tileSize)
+	, m_tileCount((imageSize + tileSize - 1) / tileSize)
+	, m_mask(size_t(m_tileCount.x) * m_tileCount.y, 0)
+	, m_markedCount(0)
+{
+}
+
+void Lilac::TileMask::clear()
+{
+	std::fill(m_mask.begin(), m_mask.end(), 0);
+	m_markedCount = 0;
+}
+
+size_t Lilac::TileMask::markBounds(const Camera& camera, const SparseVoxelOctree::Bounds& bounds)
+{
+	glm::vec2 pixelMin(std::numeric_limits<float>::infinity());
+	glm::vec2 pixelMax(-std::numeric_limits<float>::infinity());
+
+	for (size_t i = 0; i < 8; i++)
+	{
+		glm::vec3 corner(
+			(i & 1) ? bounds.max.x : bounds.min.x,
+			(i & 2) ? bounds.max.y : bounds.min.y,
+			(i & 4) ? bounds.max.z : bounds.min.z);
+
+		glm::vec2 pixelCoords = camera.worldToPixelCoords(corner, glm::vec2(m_imageSize));
+		pixelMin = glm::min(pixelMin, pixelCoords);
+		pixelMax = glm::max(pixelMax, pixelCoords);
+	}
+
+	if (pixelMax.x < 0.0f || pixelMax.y < 0.0f || pixelMin.x >= m_imageSize.x || pixelMin.y >= m_imageSize.y)
+	{
+		return 0;
+	}
+
+	// A pixel is affected if any of its samples is, and samples are jittered anywhere inside the pixel
+	pixelMin = glm::max(pixelMin, glm::vec2(0.0f));
+	pixelMax = glm::min(pixelMax, glm::vec2(m_imageSize - 1));
+
+	glm::ivec2 tileMin = glm::ivec2(glm::floor(pixelMin)) / m_tileSize;
+	glm::ivec2 tileMax = glm::ivec2(glm::floor(pixelMax)) / m_tileSize;
+
+	for (int y = tileMin.y; y <= tileMax.y; y++)
+	{
+		for (int x = tileMin.x; x <= tileMax.x; x++)
+		{
+			auto& isMarked = m_mask[size_t(y) * m_tileCount.x + x];
+			m_markedCount += !isMarked;
+			isMarked = 1;
+		}
+	}
+
+	return size_t(tileMax.x - tileMin.x + 1) * size_t(tileMax.y - tileMin.y + 1);
+}
+
+size_t Lilac::TileMask::getMarkedCount() const
+{
+	return m_markedCount;
+}
+
+size_t Lilac::TileMask::getTileCount() const
+{
+	return m_mask.size();
+}
+
+std::vector<GLuint> Lilac::TileMask::getMarkedTiles() const
+{
+	std::vector<GLuint> tiles;
+	tiles.reserve(m_markedCount);
+
+	for (int y = 0; y < m_tileCount.y; y++)
+	{
+		for (int x = 0; x < m_tileCount.x; x++)
+		{
+			if (m_mask[size_t(y) * m_tileCount.x + x])
+			{
+				tiles.push_back(GLuint(x) | GLuint(y) << 16);
+			}
+		}
+	}
+
+	return tiles;
+}
@@ -0,0 +1,111 @@
+#include <Lilac/Trace.h>
+#include <Lilac/Log.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+std::mutex Lilac::Trace::s_mutex;
+std::vector<std::shared_ptr<Lilac::Trace::ThreadBuffer>> Lilac::Trace::s_buffers;
+
+Lilac::Trace::Zone::Zone(const char* name)
+	: m_name(name)
+	, m_startNanoseconds(now())
+{
+}
+
+Lilac::Trace::Zone::~Zone()
+{
+	record(m_name, m_startNanoseconds, now() - m_startNanoseconds);
+}
+
+void Lilac::Trace::record(const char* name, int64_t startNanoseconds, int64_t durationNanoseconds)
+{
+	auto& buffer = getThreadBuffer();
+	Event event{ name, startNanoseconds, durationNanoseconds };
+
+	if (buffer.events.size() < s_eventCapacity)
+	{
+		buffer.events.push_back(event);
+	}
+	else
+	{
+		buffer.events[buffer.next] = event;
+	}
+
+	buffer.next = (buffer.next + 1) % s_eventCapacity;
+}
+
+bool Lilac::Trace::writeJson(const std::filesystem::path& path)
+{
+	std::ofstream file(path, std::ios::trunc);
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool isFirst = true;
+	std::lock_guard lock(s_mutex);
+
+	for (const auto& buffer : s_buffers)
+	{
+		for (const auto& event : buffer->events)
+		{
+			// Complete events, timestamps are in microseconds
+			file << (isFirst ? "\n" : ",\n") << "{\"name\":\"";
+
+			for (const char* c = event.name; *c != '\0'; c++)
+			{
+				if (*c == '"' || *c == '\\')
+				{
+					file << '\\';
+				}
+
+				file << *c;
+			}
+
+			file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+				<< ",\"ts\":" << double(event.startNanoseconds) / 1e3
+				<< ",\"dur\":" << double(event.durationNanoseconds) / 1e3 << "}";
+
+			isFirst = false;
+		}
+	}
+
+	file << "\n]}\n";
+
+	if (!file)
+	{
+		LILAC_LOG_WARNING("Trace", "Failed to write " << path);
+		return false;
+	}
+
+	return true;
+}
+
+int64_t Lilac::Trace::now()
+{
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+Lilac::Trace::ThreadBuffer& Lilac::Trace::getThreadBuffer()
+{
+	thread_local std::shared_ptr<ThreadBuffer> buffer;
+
+	if (buffer == nullptr)
+	{
+		buffer = std::make_shared<ThreadBuffer>();
+
+		std::lock_guard lock(s_mutex);
+		buffer->threadId = uint32_t(s_buffers.size()) + 1;
+		s_buffers.push_back(buffer);
+	}
+
+	return *buffer;
+}
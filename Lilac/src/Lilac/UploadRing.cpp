@@ -0,0 +1,131 @@
+#include <Lilac/UploadRing.h>
+#include <Lilac/Trace.h>
+#include <Lilac/Log.h>
+
+#include <cstddef>
+#include <cstring>
+
+
+Lilac::UploadRing::UploadRing(size_t frameBytes)
+	: m_buffer(0)
+	, m_mapping(nullptr)
+	, m_frameBytes(frameBytes)
+	, m_frame(0)
+	, m_used(0)
+	, m_isFrameBegun(false)
+	, m_fences{}
+{
+	if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage)
+	{
+		LILAC_LOG_INFO("UploadRing", "No buffer storage support, uploading through glBufferSubData");
+		return;
+	}
+
+	// Coherent, writes become visible to the GPU without flushing, the fences take care of the ordering
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+	glBufferStorage(GL_COPY_READ_BUFFER, m_frameBytes * s_frameCount, nullptr, flags);
+	m_mapping = static_cast<std::byte*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, m_frameBytes * s_frameCount, flags));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	if (m_mapping == nullptr)
+	{
+		LILAC_LOG_WARNING("UploadRing", "Failed to map the staging buffer, uploading through glBufferSubData");
+		glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+	}
+}
+
+Lilac::UploadRing::~UploadRing()
+{
+	for (auto fence : m_fences)
+	{
+		if (fence != nullptr)
+		{
+			glDeleteSync(fence);
+		}
+	}
+
+	// Deleting a buffer unmaps it
+	glDeleteBuffers(1, &m_buffer);
+}
+
+bool Lilac::UploadRing::isPersistent() const
+{
+	return m_mapping != nullptr;
+}
+
+void Lilac::UploadRing::upload(GLuint buffer, GLintptr offset, const void* data, size_t size)
+{
+	size_t start = (m_used + s_alignment - 1) / s_alignment * s_alignment;
+
+	if (!isPersistent() || start + size > m_frameBytes)
+	{
+		// May wait on the GPU if it still reads the buffer, fine for the odd large upload
+		LILAC_LOG_DEBUG("UploadRing", "Uploading " << size << " bytes through glBufferSubData");
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return;
+	}
+
+	beginFrame();
+
+	size_t ringOffset = m_frame * m_frameBytes + start;
+	std::memcpy(m_mapping + ringOffset, data, size);
+	m_used = start + size;
+
+	// Ordered with the commands around it like any other, whatever is submitted after it reads the new data
+	glBindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(ringOffset), offset, GLsizeiptr(size));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void Lilac::UploadRing::endFrame()
+{
+	// Regions nothing was written to are kept for the next frame
+	if (m_used == 0)
+	{
+		return;
+	}
+
+	m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_frame = (m_frame + 1) % s_frameCount;
+	m_used = 0;
+	m_isFrameBegun = false;
+}
+
+void Lilac::UploadRing::beginFrame()
+{
+	if (m_isFrameBegun)
+	{
+		return;
+	}
+
+	m_isFrameBegun = true;
+
+	if (m_fences[m_frame] == nullptr)
+	{
+		return;
+	}
+
+	LILAC_TRACE_SCOPE("upload ring wait");
+
+	// Flushing makes sure the fence is ever signaled
+	GLenum status = glClientWaitSync(m_fences[m_frame], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+
+	if (status == GL_WAIT_FAILED)
+	{
+		// Nothing left to wait on, finish everything instead
+		LILAC_LOG_WARNING("UploadRing", "Waiting on a region failed");
+		glFinish();
+	}
+
+	glDeleteSync(m_fences[m_frame]);
+	m_fences[m_frame] = nullptr;
+}
@@ -0,0 +1,207 @@
+#include <Lilac/WorkGroupTuner.h>
+#include <Lilac/GpuTimer.h>
+#include <Lilac/Log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+Lilac::WorkGroupTuner::WorkGroupTuner(std::filesystem::path resultsPath)
+	: m_resultsPath(std::move(resultsPath))
+	, m_device(getDriverString()) // A driver update retunes too
+{
+}
+
+// Each line is "x y device"
+std::optional<glm::ivec2> Lilac::WorkGroupTuner::load() const
+{
+	std::ifstream file(m_resultsPath);
+	std::string line;
+
+	while (std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		glm::ivec2 workGroupSize(0, 0);
+		std::string device;
+
+		if (stream >> workGroupSize.x >> workGroupSize.y && std::getline(stream >> std::ws, device) && device == m_device)
+		{
+			return workGroupSize;
+		}
+	}
+
+	return std::nullopt;
+}
+
+void Lilac::WorkGroupTuner::store(glm::ivec2 workGroupSize) const
+{
+	// Results of other devices are kept
+	std::vector<std::string> lines;
+
+	{
+		std::ifstream file(m_resultsPath);
+		std::string line;
+
+		while (std::getline(file, line))
+		{
+			std::istringstream stream(line);
+			int x = 0, y = 0;
+			std::string device;
+
+			if (stream >> x >> y && std::getline(stream >> std::ws, device) && device != m_device)
+			{
+				lines.push_back(line);
+			}
+		}
+	}
+
+	lines.push_back(std::to_string(workGroupSize.x) + " " + std::to_string(workGroupSize.y) + " " + m_device);
+
+	std::error_code error;
+	std::filesystem::create_directories(m_resultsPath.parent_path(), error);
+
+	std::ofstream file(m_resultsPath, std::ios::trunc);
+
+	for (const auto& line : lines)
+	{
+		file << line << "\n";
+	}
+
+	if (!file)
+	{
+		LILAC_LOG_WARNING("WorkGroupTuner", "Failed to write " << m_resultsPath);
+	}
+}
+
+std::vector<glm::ivec2> Lilac::WorkGroupTuner::getCandidates()
+{
+	GLint maxSizeX = 0, maxSizeY = 0, maxInvocations = 0;
+	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &maxSizeX);
+	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 1, &maxSizeY);
+	glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations);
+
+	// Powers of two only, that's what warp and wavefront sizes are
+	std::vector<glm::ivec2> candidates;
+
+	for (int y = 1; y <= maxSizeY; y *= 2)
+	{
+		for (int x = 1; x <= maxSizeX; x *= 2)
+		{
+			int invocations = x * y;
+			bool isSquareEnough = x <= y * s_maxAspectRatio && y <= x * s_maxAspectRatio;
+
+			if (invocations >= s_minInvocations && invocations <= std::min(s_maxInvocations, int(maxInvocations)) && isSquareEnough)
+			{
+				candidates.emplace_back(x, y);
+			}
+		}
+	}
+
+	return candidates;
+}
+
+std::optional<glm::ivec2> Lilac::WorkGroupTuner::tune(ComputeVariantCache& variants, ComputeVariantCache::Features features, const Dispatch& dispatch) const
+{
+	auto candidates = getCandidates();
+
+	if (candidates.empty())
+	{
+		LILAC_LOG_ERROR("WorkGroupTuner", "No candidates within the device limits");
+		return std::nullopt;
+	}
+
+	auto getFeatures = [&features](glm::ivec2 workGroupSize) {
+		features.insert_or_assign("WORKGROUP_SIZE_X", std::to_string(workGroupSize.x));
+		features.insert_or_assign("WORKGROUP_SIZE_Y", std::to_string(workGroupSize.y));
+		return features;
+	};
+
+	// All submitted up front, so parallel shader compile can build them side by side
+	for (auto candidate : candidates)
+	{
+		variants.prepare(getFeatures(candidate));
+	}
+
+	std::optional<glm::ivec2> best;
+	float bestMilliseconds = std::numeric_limits<float>::infinity();
+	GpuTimer timer;
+	bool isWallClockLogged = false;
+
+	for (auto candidate : candidates)
+	{
+		auto* program = variants.get(getFeatures(candidate));
+
+		if (program == nullptr)
+		{
+			LILAC_LOG_WARNING("WorkGroupTuner", "Skipping " << candidate.x << "x" << candidate.y << ", it failed to build");
+			continue;
+		}
+
+		for (int i = 0; i < s_warmupDispatches; i++)
+		{
+			dispatch(*program, candidate);
+		}
+
+		// Nothing else is in flight, so the wall clock around a dispatch and glFinish times just the dispatch
+		glFinish();
+
+		float fastest = std::numeric_limits<float>::infinity();
+
+		for (int i = 0; i < s_timedDispatches; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			timer.begin();
+			dispatch(*program, candidate);
+			timer.end();
+
+			// The result is available once everything before it finished
+			glFinish();
+
+			float wallMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+			float milliseconds = 0.0f;
+
+			if (!timer.tryGetElapsed(milliseconds) || milliseconds <= 0.0f)
+			{
+				if (!isWallClockLogged)
+				{
+					LILAC_LOG_WARNING("WorkGroupTuner", "Timer queries read nothing, timing by wall clock instead");
+					isWallClockLogged = true;
+				}
+
+				milliseconds = wallMilliseconds;
+			}
+
+			if (milliseconds > 0.0f)
+			{
+				fastest = std::min(fastest, milliseconds);
+			}
+		}
+
+		LILAC_LOG_INFO("WorkGroupTuner", candidate.x << "x" << candidate.y << ": " << fastest << " ms");
+
+		if (fastest < bestMilliseconds)
+		{
+			best = candidate;
+			bestMilliseconds = fastest;
+		}
+	}
+
+	if (!best)
+	{
+		LILAC_LOG_WARNING("WorkGroupTuner", "None of the candidates could be timed");
+		return std::nullopt;
+	}
+
+	LILAC_LOG_INFO("WorkGroupTuner", "Tuned workgroup size: " << best->x << "x" << best->y);
+
+	return best;
+}
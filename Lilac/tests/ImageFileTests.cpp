@@ -0,0 +1,94 @@
+#include "Test.h"
+
+#include <Lilac/ImageFile.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+
+namespace
+{
+const glm::ivec2 imageSize(2, 2);
+
+std::string readFile(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::binary);
+
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void testPpmFlipsRowsAndDropsAlpha()
+{
+	// Bottom row first, the way glReadPixels returns it, alpha set to make sure it isn't written
+	const uint8_t rgba[] = {
+		1, 2, 3, 200, 4, 5, 6, 201,
+		7, 8, 9, 202, 10, 11, 12, 203
+	};
+
+	auto path = std::filesystem::temp_directory_path() / "lilac_image.ppm";
+	LILAC_CHECK(Lilac::writePpm(path, imageSize, rgba));
+
+	std::string contents = readFile(path);
+	std::filesystem::remove(path);
+
+	const std::string header = "P6\n2 2\n255\n";
+	LILAC_CHECK(contents.size() == header.size() + 2 * 2 * 3);
+	LILAC_CHECK(contents.compare(0, header.size(), header) == 0);
+
+	if (contents.size() != header.size() + 2 * 2 * 3)
+	{
+		return;
+	}
+
+	// PPM starts at the top row
+	const uint8_t expected[] = { 7, 8, 9, 10, 11, 12, 1, 2, 3, 4, 5, 6 };
+	LILAC_CHECK(std::memcmp(contents.data() + header.size(), expected, sizeof(expected)) == 0);
+}
+
+void testPfmKeepsRowsAndDropsAlpha()
+{
+	const float rgba[] = {
+		0.5f, 1.5f, 2.5f, 9.0f, 3.5f, 4.5f, 5.5f, 9.0f,
+		6.5f, 7.5f, 8.5f, 9.0f, 10.5f, 11.5f, 12.5f, 9.0f
+	};
+
+	auto path = std::filesystem::temp_directory_path() / "lilac_image.pfm";
+	LILAC_CHECK(Lilac::writePfm(path, imageSize, rgba));
+
+	std::string contents = readFile(path);
+	std::filesystem::remove(path);
+
+	const std::string header = "PF\n2 2\n-1.0\n";
+	LILAC_CHECK(contents.size() == header.size() + 2 * 2 * 3 * sizeof(float));
+	LILAC_CHECK(contents.compare(0, header.size(), header) == 0);
+
+	if (contents.size() != header.size() + 2 * 2 * 3 * sizeof(float))
+	{
+		return;
+	}
+
+	// PFM starts at the bottom row, same as the input
+	const float expected[] = { 0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f, 8.5f, 10.5f, 11.5f, 12.5f };
+	LILAC_CHECK(std::memcmp(contents.data() + header.size(), expected, sizeof(expected)) == 0);
+}
+
+void testUnwritablePath()
+{
+	const uint8_t rgba[2 * 2 * 4] = {};
+
+	LILAC_CHECK(!Lilac::writePpm(std::filesystem::temp_directory_path() / "lilac_missing_directory" / "image.ppm", imageSize, rgba));
+}
+}
+
+int main()
+{
+	testPpmFlipsRowsAndDropsAlpha();
+	testPfmKeepsRowsAndDropsAlpha();
+	testUnwritablePath();
+
+	return Lilac::Test::getExitCode();
+}
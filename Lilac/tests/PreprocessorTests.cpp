@@ -0,0 +1,170 @@
+#include "Test.h"
+
+#include <Lilac/Preprocessor.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+
+namespace
+{
+Lilac::Preprocessor makePreprocessor(std::map<std::string, std::string> macros = {}, std::vector<std::filesystem::path> includeDirectories = {})
+{
+	return Lilac::Preprocessor{ std::move(macros), std::move(includeDirectories), 8 };
+}
+
+std::string getMacro(const Lilac::Preprocessor& preprocessor, const std::string& name)
+{
+	auto found = preprocessor.getMacros().find(name);
+	return found == preprocessor.getMacros().end() ? "<undefined>" : found->second;
+}
+
+size_t countLines(const std::string& text)
+{
+	return size_t(std::count(text.begin(), text.end(), '\n')) + 1;
+}
+
+void testSubstitutesWholeIdentifiers()
+{
+	auto preprocessor = makePreprocessor({ { "SIZE_X", "8" } });
+	auto output = preprocessor.process("int a = SIZE_X; int b = SIZE_XY; // SIZE_X");
+
+	LILAC_CHECK(output == "int a = 8; int b = SIZE_XY; // SIZE_X");
+}
+
+void testDefineFollowsTakenBranch()
+{
+	const std::string source =
+		"#if X\n"
+		"#define N 4\n"
+		"#else\n"
+		"#define N 8\n"
+		"#endif\n"
+		"int n = N;";
+
+	auto taken = makePreprocessor({ { "X", "1" } });
+	auto takenOutput = taken.process(source);
+
+	LILAC_CHECK(getMacro(taken, "N") == "4");
+	LILAC_CHECK(takenOutput == "\n\n\n\n\nint n = 4;");
+
+	auto notTaken = makePreprocessor({ { "X", "0" } });
+	auto notTakenOutput = notTaken.process(source);
+
+	LILAC_CHECK(getMacro(notTaken, "N") == "8");
+	LILAC_CHECK(notTakenOutput == "\n\n\n\n\nint n = 8;");
+}
+
+void testEvaluatesExpressions()
+{
+	auto preprocessor = makePreprocessor({ { "LEVELS", "4" }, { "MODE", "ROPES" }, { "ROPES", "1" } });
+	auto output = preprocessor.process(
+		"#if LEVELS > 2 && (MODE == ROPES || 0x10u / 0)\n"
+		"a\n"
+		"#elif defined(LEVELS)\n"
+		"b\n"
+		"#endif\n"
+		"#ifdef MISSING\n"
+		"c\n"
+		"#elif !defined MISSING && LEVELS % 3 == 1\n"
+		"d\n"
+		"#endif");
+
+	// The first condition divides by zero, so it can't be evaluated and goes to the GLSL compiler
+	LILAC_CHECK(output.starts_with("#if 4 > 2 && (1 == 1 || 0x10u / 0)\na\n#elif 1\nb\n#endif\n"));
+	LILAC_CHECK(output.ends_with("\n\n\nd\n"));
+}
+
+void testNestedBranchesNotTaken()
+{
+	auto preprocessor = makePreprocessor({ { "A", "0" } });
+	auto output = preprocessor.process(
+		"#if A\n"
+		"#if 1\n"
+		"#define N 1\n"
+		"#else\n"
+		"#define N 2\n"
+		"#endif\n"
+		"#else\n"
+		"#define N 3\n"
+		"#endif");
+
+	LILAC_CHECK(getMacro(preprocessor, "N") == "3");
+	LILAC_CHECK(countLines(output) == 9);
+	LILAC_CHECK(output.find_first_not_of('\n') == std::string::npos);
+}
+
+void testCompilerConditionsArePassedThrough()
+{
+	auto preprocessor = makePreprocessor({ { "N", "2" } });
+	auto output = preprocessor.process(
+		"#ifdef GL_ES\n"
+		"#define PRECISION 1\n"
+		"#else\n"
+		"#define PRECISION 2\n"
+		"#endif\n"
+		"#if PRECISION == N\n"
+		"x\n"
+		"#endif");
+
+	LILAC_CHECK(getMacro(preprocessor, "PRECISION") == "<undefined>");
+	LILAC_CHECK(output == "#if defined GL_ES\n#define PRECISION 1\n#else\n#define PRECISION 2\n#endif\n#if PRECISION == 2\nx\n#endif");
+}
+
+void testFunctionLikeMacrosArePassedThrough()
+{
+	auto preprocessor = makePreprocessor();
+	auto output = preprocessor.process(
+		"#define COUNT() count++\n"
+		"#ifdef COUNT\n"
+		"y\n"
+		"#endif");
+
+	LILAC_CHECK(output == "#define COUNT() count++\n#if defined COUNT\ny\n#endif");
+}
+
+void testIncludeGuards()
+{
+	auto directory = std::filesystem::temp_directory_path() / "lilac_preprocessor_tests";
+	std::filesystem::create_directories(directory);
+
+	{
+		std::ofstream file(directory / "guarded.glsl");
+		file << "#ifndef GUARDED_GLSL\n#define GUARDED_GLSL\nint guarded;\n#endif\n";
+	}
+
+	auto preprocessor = makePreprocessor({}, { directory });
+	auto output = preprocessor.process("#include \"guarded.glsl\"\n#include \"guarded.glsl\"\nint main;");
+
+	LILAC_CHECK(getMacro(preprocessor, "GUARDED_GLSL") == "");
+	LILAC_CHECK(output.find("int guarded;") != std::string::npos);
+	LILAC_CHECK(output.find("int guarded;") == output.rfind("int guarded;"));
+	LILAC_CHECK(output.ends_with("int main;"));
+
+	std::filesystem::remove_all(directory);
+}
+
+void testMissingEndif()
+{
+	auto preprocessor = makePreprocessor();
+	auto output = preprocessor.process("#if 1\nx");
+
+	LILAC_CHECK(output.ends_with("#error #if without an #endif"));
+}
+}
+
+int main()
+{
+	testSubstitutesWholeIdentifiers();
+	testDefineFollowsTakenBranch();
+	testEvaluatesExpressions();
+	testNestedBranchesNotTaken();
+	testCompilerConditionsArePassedThrough();
+	testFunctionLikeMacrosArePassedThrough();
+	testIncludeGuards();
+	testMissingEndif();
+
+	return Lilac::Test::getExitCode();
+}
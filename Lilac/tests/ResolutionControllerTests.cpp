@@ -0,0 +1,94 @@
+#include "Test.h"
+
+#include <Lilac/ResolutionController.h>
+
+#include <glm/vec2.hpp>
+
+
+namespace
+{
+const glm::ivec2 maxSize(800, 600);
+
+void addFrames(Lilac::ResolutionController& controller, float milliseconds, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		controller.addFrameTime(milliseconds);
+	}
+}
+
+void testStartsAtMaxSize()
+{
+	Lilac::ResolutionController controller{ maxSize, 10.0f, 0.5f };
+
+	LILAC_CHECK(controller.getSize() == maxSize);
+	LILAC_CHECK(controller.getScale() == 1.0f);
+	LILAC_CHECK(controller.getRevision() == 0);
+}
+
+void testOnBudgetKeepsSize()
+{
+	Lilac::ResolutionController controller{ maxSize, 10.0f, 0.5f };
+	addFrames(controller, 10.5f, 100);
+
+	LILAC_CHECK(controller.getSize() == maxSize);
+	LILAC_CHECK(controller.getRevision() == 0);
+}
+
+void testWaitsForFramesToSettle()
+{
+	Lilac::ResolutionController controller{ maxSize, 10.0f, 0.5f };
+	addFrames(controller, 20.0f, 7);
+
+	LILAC_CHECK(controller.getRevision() == 0);
+
+	addFrames(controller, 20.0f, 1);
+
+	LILAC_CHECK(controller.getRevision() == 1);
+	LILAC_CHECK(controller.getSize().x < maxSize.x);
+	LILAC_CHECK(controller.getSize().y < maxSize.y);
+}
+
+void testOverBudgetStopsAtMinScale()
+{
+	Lilac::ResolutionController controller{ maxSize, 10.0f, 0.5f };
+	addFrames(controller, 1000.0f, 200);
+
+	LILAC_CHECK(controller.getScale() == 0.5f);
+	LILAC_CHECK(controller.getSize() == glm::ivec2(400, 300));
+}
+
+void testUnderBudgetGrowsBackToMaxSize()
+{
+	Lilac::ResolutionController controller{ maxSize, 10.0f, 0.25f };
+	addFrames(controller, 1000.0f, 200);
+	auto revision = controller.getRevision();
+
+	addFrames(controller, 1.0f, 200);
+
+	LILAC_CHECK(controller.getRevision() > revision);
+	LILAC_CHECK(controller.getScale() == 1.0f);
+	LILAC_CHECK(controller.getSize() == maxSize);
+}
+
+void testIgnoresEmptyTimings()
+{
+	Lilac::ResolutionController controller{ maxSize, 10.0f, 0.5f };
+	addFrames(controller, 0.0f, 100);
+
+	LILAC_CHECK(controller.getSize() == maxSize);
+	LILAC_CHECK(controller.getRevision() == 0);
+}
+}
+
+int main()
+{
+	testStartsAtMaxSize();
+	testOnBudgetKeepsSize();
+	testWaitsForFramesToSettle();
+	testOverBudgetStopsAtMinScale();
+	testUnderBudgetGrowsBackToMaxSize();
+	testIgnoresEmptyTimings();
+
+	return Lilac::Test::getExitCode();
+}
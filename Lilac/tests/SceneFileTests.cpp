@@ -0,0 +1,131 @@
+#include "Test.h"
+
+#include <Lilac/SceneFile.h>
+
+#include <glm/geometric.hpp>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+
+namespace
+{
+std::filesystem::path writeScene(const std::string& name, const std::string& contents)
+{
+	auto path = std::filesystem::temp_directory_path() / name;
+	std::ofstream file(path);
+	file << contents;
+
+	return path;
+}
+
+bool isNear(glm::vec3 a, glm::vec3 b)
+{
+	return glm::length(a - b) < 1e-5f;
+}
+
+void testLoadsStatements()
+{
+	auto path = writeScene("lilac_scene_statements.scene",
+		"# Comment line\n"
+		"voxel 1 2 3 4 # trailing comment\n"
+		"box 0 0 0 2 1 2 7\n"
+		"camera 10 20 30 0 0 -2 5\n"
+		"light 0.5 1 0\n");
+
+	auto scene = Lilac::SceneFile::load(path);
+	std::filesystem::remove(path);
+
+	LILAC_CHECK(scene.has_value());
+
+	if (!scene)
+	{
+		return;
+	}
+
+	LILAC_CHECK(scene->voxels.size() == 1 + 4);
+	LILAC_CHECK(scene->voxels[0].x == 1 && scene->voxels[0].y == 2 && scene->voxels[0].z == 3 && scene->voxels[0].materialId == 4);
+
+	// Max is exclusive, x first
+	LILAC_CHECK(scene->voxels[2].x == 1 && scene->voxels[2].y == 0 && scene->voxels[2].z == 0 && scene->voxels[2].materialId == 7);
+	LILAC_CHECK(scene->voxels[4].x == 1 && scene->voxels[4].z == 1);
+
+	LILAC_CHECK(isNear(scene->camera.origin, glm::vec3(10.0f, 20.0f, 30.0f)));
+	LILAC_CHECK(isNear(scene->camera.forward, glm::vec3(0.0f, 0.0f, -1.0f)));
+	LILAC_CHECK(scene->camera.halfSize == 5.0f);
+	LILAC_CHECK(isNear(scene->lightColor, glm::vec3(0.5f, 1.0f, 0.0f)));
+}
+
+void testDefaultsWithoutStatements()
+{
+	auto path = writeScene("lilac_scene_empty.scene", "\n# Nothing\n");
+
+	auto scene = Lilac::SceneFile::load(path);
+	std::filesystem::remove(path);
+
+	LILAC_CHECK(scene.has_value() && scene->voxels.empty());
+	LILAC_CHECK(scene.has_value() && isNear(scene->camera.origin, Lilac::Camera{}.origin));
+}
+
+void testUpStatement()
+{
+	auto path = writeScene("lilac_scene_up.scene", "camera 0 0 0 1 0 0 4\nup 0 0 2\n");
+
+	auto scene = Lilac::SceneFile::load(path);
+	std::filesystem::remove(path);
+
+	LILAC_CHECK(scene.has_value() && isNear(scene->camera.up, glm::vec3(0.0f, 0.0f, 1.0f)));
+}
+
+void testParallelUpIsReplaced()
+{
+	for (float y : { -1.0f, 1.0f })
+	{
+		auto path = writeScene("lilac_scene_parallel_up.scene", "camera 0 10 0 0 " + std::to_string(y) + " 0 4\n");
+
+		auto scene = Lilac::SceneFile::load(path);
+		std::filesystem::remove(path);
+
+		LILAC_CHECK(scene.has_value());
+
+		if (scene)
+		{
+			auto right = glm::cross(scene->camera.forward, scene->camera.up);
+
+			LILAC_CHECK(std::abs(glm::length(scene->camera.up) - 1.0f) < 1e-5f);
+			LILAC_CHECK(std::abs(glm::dot(scene->camera.forward, scene->camera.up)) < 1e-5f);
+			LILAC_CHECK(glm::length(right) > 0.5f);
+		}
+	}
+}
+
+void testRejectsBadLines()
+{
+	for (const char* contents : { "voxel 1 2\n", "voxel 1 2 3 4 5\n", "sphere 1 2 3\n", "camera 0 0 0 1 0 0\n", "up 0 1\n" })
+	{
+		auto path = writeScene("lilac_scene_bad.scene", contents);
+
+		LILAC_CHECK(!Lilac::SceneFile::load(path).has_value());
+		std::filesystem::remove(path);
+	}
+}
+
+void testMissingFile()
+{
+	LILAC_CHECK(!Lilac::SceneFile::load(std::filesystem::temp_directory_path() / "lilac_scene_missing.scene").has_value());
+}
+}
+
+int main()
+{
+	testLoadsStatements();
+	testDefaultsWithoutStatements();
+	testUpStatement();
+	testParallelUpIsReplaced();
+	testRejectsBadLines();
+	testMissingFile();
+
+	return Lilac::Test::getExitCode();
+}
@@ -0,0 +1,28 @@
+#ifndef LILAC_TEST_H
+#define LILAC_TEST_H
+
+#include <cstdlib>
+#include <iostream>
+
+// Each tests/*Tests.cpp is its own executable run by CTest, a failed check prints itself and fails the run
+namespace Lilac::Test
+{
+inline int failureCount = 0;
+
+inline int getExitCode()
+{
+	return failureCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+}
+
+#define LILAC_CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": Check failed: " << #condition << std::endl; \
+			Lilac::Test::failureCount++; \
+		} \
+	} while (false)
+
+#endif // LILAC_TEST_H
@@ -0,0 +1,85 @@
+#include "Test.h"
+
+#include <Lilac/TileMask.h>
+#include <Lilac/Camera.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+
+
+namespace
+{
+const glm::ivec2 imageSize(128, 64);
+const glm::ivec2 tileSize(16, 16);
+
+// The default camera looks at (8, 8, 8) through the middle of the image
+const Lilac::SparseVoxelOctree::Bounds centerBounds{ glm::vec3(7.9f), glm::vec3(8.1f) };
+
+void testMarksTilesUnderBounds()
+{
+	Lilac::TileMask mask{ imageSize, tileSize };
+	Lilac::Camera camera;
+
+	LILAC_CHECK(mask.getTileCount() == 8 * 4);
+	LILAC_CHECK(mask.getMarkedCount() == 0);
+
+	size_t covered = mask.markBounds(camera, centerBounds);
+
+	LILAC_CHECK(covered > 0);
+	LILAC_CHECK(mask.getMarkedCount() == covered);
+
+	// Around the middle of the image, tile (4, 2) holds pixel (64, 32)
+	auto tiles = mask.getMarkedTiles();
+	LILAC_CHECK(tiles.size() == covered);
+	LILAC_CHECK(std::find(tiles.begin(), tiles.end(), GLuint(4 | 2 << 16)) != tiles.end());
+}
+
+void testMarkingTwiceCountsOnce()
+{
+	Lilac::TileMask mask{ imageSize, tileSize };
+	Lilac::Camera camera;
+
+	size_t covered = mask.markBounds(camera, centerBounds);
+	size_t coveredAgain = mask.markBounds(camera, centerBounds);
+
+	LILAC_CHECK(coveredAgain == covered);
+	LILAC_CHECK(mask.getMarkedCount() == covered);
+
+	mask.clear();
+	LILAC_CHECK(mask.getMarkedCount() == 0);
+	LILAC_CHECK(mask.getMarkedTiles().empty());
+}
+
+void testOffScreenMarksNothing()
+{
+	Lilac::TileMask mask{ imageSize, tileSize };
+	Lilac::Camera camera;
+	camera.pan(glm::vec2(0.0f, 100.0f));
+
+	LILAC_CHECK(mask.markBounds(camera, centerBounds) == 0);
+	LILAC_CHECK(mask.getMarkedCount() == 0);
+}
+
+void testLargeBoundsMarkEveryTile()
+{
+	Lilac::TileMask mask{ imageSize, tileSize };
+	Lilac::Camera camera;
+
+	size_t covered = mask.markBounds(camera, { glm::vec3(-100.0f), glm::vec3(100.0f) });
+
+	LILAC_CHECK(covered == mask.getTileCount());
+	LILAC_CHECK(mask.getMarkedCount() == mask.getTileCount());
+}
+}
+
+int main()
+{
+	testMarksTilesUnderBounds();
+	testMarkingTwiceCountsOnce();
+	testOffScreenMarksNothing();
+	testLargeBoundsMarkEveryTile();
+
+	return Lilac::Test::getExitCode();
+}